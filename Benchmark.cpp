@@ -0,0 +1,694 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CompactRedBlackTree.h"
+#include "FastIntReader.h"
+#include "FrozenTree.h"
+#include "PersistentRedBlackTree.h"
+#include "RedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+#include "ThreadPool.h"
+#include "TreeJournal.h"
+#include "TreeSnapshot.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::vector<int> randomKeys(const std::size_t count, const unsigned seed) {
+        std::mt19937 rng(seed);
+        std::vector<int> keys(count);
+        for (int& key : keys) {
+            key = static_cast<int>(rng());
+        }
+        return keys;
+    }
+
+    //Times insert, search and remove on any tree with insert(key), contains(key) and remove(key) style calls
+    template <typename InsertFn, typename SearchFn, typename RemoveFn>
+    void timeOperations(const char* name, const std::vector<int>& keys, InsertFn insert, SearchFn search,
+                        RemoveFn remove, std::size_t bytesPerNode, std::size_t bytesReserved) {
+        Clock::time_point start = Clock::now();
+        for (const int key : keys) {
+            insert(key);
+        }
+        const double insertMs = millisecondsSince(start);
+
+        start = Clock::now();
+        std::size_t found = 0;
+        for (const int key : keys) {
+            found += search(key) ? 1 : 0;
+        }
+        const double searchMs = millisecondsSince(start);
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < keys.size(); i += 2) {
+            remove(keys[i]);
+        }
+        const double removeMs = millisecondsSince(start);
+
+        std::cout << std::left << std::setw(22) << name << std::right
+            << std::setw(10) << insertMs << std::setw(10) << searchMs << std::setw(10) << removeMs
+            << std::setw(12) << bytesPerNode << std::setw(14) << bytesReserved / 1024 << "  (" << found << " found)"
+            << std::endl;
+    }
+
+    //Pointer nodes vs 32-bit index nodes
+    void benchmarkCompactLayout(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 1);
+        std::cout << "\n--- Node layout: " << keyCount << " random keys (times in ms) ---" << std::endl;
+        std::cout << std::left << std::setw(22) << "tree" << std::right << std::setw(10) << "insert" << std::setw(10)
+            << "search" << std::setw(10) << "remove" << std::setw(12) << "bytes/node" << std::setw(14) << "reserved KiB"
+            << std::endl;
+
+        {
+            RedBlackTree tree;
+            tree.reserve(keyCount);
+            timeOperations("RedBlackTree", keys,
+                           [&](const int key) { tree.insert(key); },
+                           [&](const int key) { return tree.getNode(tree.root, key) != nullptr; },
+                           [&](const int key) { tree.erase(key); },
+                           sizeof(RedBlackTree::Node), tree.bytesReserved());
+        }
+        {
+            CompactRedBlackTree tree;
+            tree.reserve(keyCount);
+            timeOperations("CompactRedBlackTree", keys,
+                           [&](const int key) { tree.insert(key); },
+                           [&](const int key) { return tree.contains(key); },
+                           [&](const int key) { tree.remove(key); },
+                           sizeof(CompactRedBlackTree::Node), tree.bytesReserved());
+        }
+    }
+
+    //In order scans with the iterators and with for_each_in_range
+    void benchmarkRangeScan(const std::size_t keyCount) {
+        std::vector<int> keys(keyCount);
+        for (std::size_t i = 0; i < keyCount; i++) {
+            keys[i] = static_cast<int>(i);
+        }
+        RedBlackTree tree;
+        tree.assignSorted(keys.begin(), keys.end());
+        std::cout << "\n--- In order scans: " << keyCount << " keys ---" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        long long sum = 0;
+        for (const int key : tree) {
+            sum += key;
+        }
+        double ms = millisecondsSince(start);
+        std::cout << "iterator walk:       " << ms << " ms (" << keyCount / std::max(ms, 0.001) / 1000 << " M keys/s)" << std::endl;
+
+        start = Clock::now();
+        tree.for_each_in_range(static_cast<int>(keyCount / 4), static_cast<int>(keyCount / 4 * 3),
+                               [&](const Node& node) { sum -= node.data; });
+        ms = millisecondsSince(start);
+        std::cout << "for_each_in_range:   " << ms << " ms (half the keys, checksum " << sum << ")" << std::endl;
+    }
+
+    //Runs the same mixed workload (50% insert, 40% search, 10% remove) on every thread and returns millions of ops per second
+    template <typename InsertFn, typename SearchFn, typename RemoveFn>
+    double timeMixedWorkload(const std::size_t threadCount, const std::size_t opsPerThread, InsertFn insert,
+                             SearchFn search, RemoveFn remove) {
+        std::vector<std::thread> threads;
+        const Clock::time_point start = Clock::now();
+        for (std::size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(static_cast<unsigned>(t + 1));
+                for (std::size_t i = 0; i < opsPerThread; i++) {
+                    const int key = static_cast<int>(rng());
+                    const unsigned op = rng() % 10;
+                    if (op < 5) {
+                        insert(key);
+                    } else if (op < 9) {
+                        search(key);
+                    } else {
+                        remove(key);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return static_cast<double>(threadCount * opsPerThread) / millisecondsSince(start) / 1000;
+    }
+
+    //One tree behind one mutex vs the sharded tree, with more and more threads
+    void benchmarkConcurrent(const std::size_t keyCount) {
+        const std::size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "\n--- Concurrent mixed workload: " << keyCount << " ops per run (M ops/s) ---" << std::endl;
+        std::cout << std::setw(8) << "threads" << std::setw(16) << "global mutex" << std::setw(16) << "sharded" << std::endl;
+
+        for (std::size_t threadCount = 1; threadCount <= std::max<std::size_t>(hardwareThreads, 4); threadCount *= 2) {
+            const std::size_t opsPerThread = keyCount / threadCount;
+
+            RedBlackTree tree;
+            std::mutex treeLock;
+            const double globalRate = timeMixedWorkload(threadCount, opsPerThread,
+                [&](const int key) { std::lock_guard<std::mutex> lock(treeLock); tree.insert(key); },
+                [&](const int key) { std::lock_guard<std::mutex> lock(treeLock); return tree.find(key) != tree.end(); },
+                [&](const int key) {
+                    std::lock_guard<std::mutex> lock(treeLock);
+                    tree.erase(key);
+                });
+
+            ShardedRedBlackTree sharded(hardwareThreads * 4);
+            const double shardedRate = timeMixedWorkload(threadCount, opsPerThread,
+                [&](const int key) { sharded.insert(key); },
+                [&](const int key) { return sharded.contains(key); },
+                [&](const int key) { sharded.remove(key); });
+
+            std::cout << std::setw(8) << threadCount << std::setw(16) << globalRate << std::setw(16) << shardedRate << std::endl;
+        }
+    }
+
+    //Cost of taking a snapshot of the persistent tree, and lookups on a snapshot while the live tree keeps changing
+    void benchmarkSnapshots(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 3);
+        std::cout << "\n--- Persistent snapshots: " << keyCount << " random keys ---" << std::endl;
+
+        PersistentRedBlackTree persistent;
+        Clock::time_point start = Clock::now();
+        for (const int key : keys) {
+            persistent.insert(key);
+        }
+        std::cout << "persistent insert:   " << millisecondsSince(start) << " ms" << std::endl;
+
+        const std::size_t snapshotCount = 1000000;
+        std::size_t total = 0;
+        start = Clock::now();
+        for (std::size_t i = 0; i < snapshotCount; i++) {
+            total += persistent.snapshot().size();
+        }
+        std::cout << "snapshot():          " << millisecondsSince(start) * 1e6 / snapshotCount << " ns each" << std::endl;
+
+        //Full copy into a new tree, what a snapshot cost before
+        start = Clock::now();
+        RedBlackTree copy;
+        const PersistentRedBlackTree::Snapshot snapshot = persistent.snapshot();
+        std::vector<int> sorted;
+        snapshot.for_each([&](const int key) { sorted.push_back(key); });
+        copy.assignSorted(sorted.begin(), sorted.end());
+        std::cout << "full copy:           " << millisecondsSince(start) << " ms" << std::endl;
+
+        //The writer churns the live tree while the snapshot is searched
+        std::thread writer([&] {
+            for (std::size_t i = 0; i < keys.size(); i += 2) {
+                persistent.remove(keys[i]);
+                persistent.insert(keys[i] ^ 1);
+            }
+        });
+        start = Clock::now();
+        std::size_t found = 0;
+        for (const int key : keys) {
+            found += snapshot.contains(key) ? 1 : 0;
+        }
+        const double snapshotMs = millisecondsSince(start);
+        writer.join();
+
+        start = Clock::now();
+        for (const int key : keys) {
+            found += copy.find(key) != copy.end() ? 1 : 0;
+        }
+        const double copyMs = millisecondsSince(start);
+        std::cout << "snapshot search:     " << snapshotMs << " ms (RedBlackTree " << copyMs << " ms, " << found
+            << " found, " << total / snapshotCount << " keys)" << std::endl;
+    }
+
+    //Restarting from a binary snapshot against parsing the keys out of a text file
+    void benchmarkSnapshotFile(const std::size_t keyCount) {
+        const char* snapshotPath = "benchmark_snapshot.bin";
+        const char* textPath = "benchmark_snapshot.txt";
+        RedBlackTree tree;
+        tree.insert_batch(randomKeys(keyCount, 14));
+        std::cout << "\n--- Snapshot file: " << tree.size() << " keys ---" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        saveSnapshot(tree, snapshotPath);
+        std::cout << "save:                " << millisecondsSince(start) << " ms" << std::endl;
+        {
+            std::ofstream text(textPath);
+            for (const int key : tree) {
+                text << key << ' ';
+            }
+        }
+
+        RedBlackTree loaded;
+        start = Clock::now();
+        const SnapshotStatus status = loadSnapshot(loaded, snapshotPath);
+        const double loadMs = millisecondsSince(start);
+        const double megabytes = static_cast<double>(sizeof(SnapshotHeader) + loaded.size() * sizeof(int)) / 1e6;
+        std::cout << "load:                " << loadMs << " ms (" << megabytes / (loadMs / 1000) << " MB/s, "
+            << snapshotStatusMessage(status) << ")" << std::endl;
+
+        RedBlackTree parsed;
+        start = Clock::now();
+        InputBuffer input;
+        input.open(textPath);
+        std::vector<int> numbers;
+        ScanResult skipped;
+        scanInts(input.begin(), input.end(), numbers, skipped);
+        parsed.insert_batch(numbers);
+        std::cout << "text file load:      " << millisecondsSince(start) << " ms" << std::endl;
+
+        std::remove(snapshotPath);
+        std::remove(textPath);
+    }
+
+    //Updates with the journal on (group commit, and one fsync per update) against the tree on its own
+    void benchmarkJournal(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 15);
+        const std::string journalBase = "benchmark_journal";
+        std::cout << "\n--- Journal: " << keyCount << " inserts then " << (keyCount + 1) / 2
+            << " removes (ns per update) ---" << std::endl;
+
+        //fsyncs run at disk speed, so the unbatched case only does a slice of the updates
+        const std::size_t unbatchedCount = std::min<std::size_t>(keyCount, 2000);
+        const std::pair<const char*, std::chrono::milliseconds> runs[] = {
+            {"in memory:", std::chrono::milliseconds(-1)}, {"journal (5 ms):", std::chrono::milliseconds(5)},
+            {"journal (no window):", std::chrono::milliseconds(0)}};
+        for (const auto& [name, window] : runs) {
+            const std::size_t count = window.count() == 0 ? unbatchedCount : keys.size();
+            RedBlackTree tree;
+            TreeJournal journal(JournalOptions{window});
+            JournalRecovery recovery;
+            if (window.count() >= 0) {
+                journal.open(tree, journalBase, recovery);
+            }
+
+            const Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i < count; i++) {
+                tree.insert(keys[i]);
+                journal.recordInsert(keys[i]);
+                if (window.count() == 0) {
+                    journal.sync();
+                }
+            }
+            for (std::size_t i = 0; i < count; i += 2) {
+                if (tree.erase(keys[i])) {
+                    journal.recordRemove(keys[i]);
+                }
+                if (window.count() == 0) {
+                    journal.sync();
+                }
+            }
+            journal.sync();
+            const double ms = millisecondsSince(start);
+            const std::size_t updates = count + (count + 1) / 2;
+            std::cout << std::left << std::setw(21) << name << std::right << ms * 1e6 / static_cast<double>(updates)
+                << " (" << updates << " updates)" << std::endl;
+
+            journal.close();
+            for (const char* suffix : {".snap", ".wal.1"}) {
+                std::remove((journalBase + suffix).c_str());
+            }
+        }
+    }
+
+    //A full validation pass on the calling thread and on every core
+    void benchmarkValidate(const std::size_t keyCount) {
+        RedBlackTree tree;
+        tree.insert_batch(randomKeys(keyCount, 16));
+        ThreadPool pool;
+        std::cout << "\n--- Validation: " << tree.size() << " keys (ms) ---" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        const auto serial = tree.validate();
+        std::cout << "1 thread:            " << millisecondsSince(start) << " ("
+            << (serial.valid() ? "valid" : treeViolationMessage(serial.violation)) << ", max depth " << serial.maxDepth
+            << ")" << std::endl;
+        start = Clock::now();
+        const auto parallel = tree.validate(&pool);
+        std::cout << std::left << std::setw(21) << std::to_string(pool.size()) + " thread(s):" << std::right
+            << millisecondsSince(start) << " (" << (parallel.valid() ? "valid" : treeViolationMessage(parallel.violation))
+            << ")" << std::endl;
+    }
+
+    //Many repeats of few keys: a count per node against std::multiset, which adds a node (and a rebalance) per copy
+    void benchmarkMultiset(const std::size_t keyCount) {
+        std::vector<int> keys = randomKeys(keyCount, 18);
+        for (int& key : keys) {
+            key &= 0xFFFF; //at most 65536 distinct keys
+        }
+        std::cout << "\n--- Multiset: " << keys.size() << " inserts of at most 65536 keys (ms) ---" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        RedBlackMultiset counted;
+        for (const int key : keys) {
+            counted.insert(key);
+        }
+        std::cout << "counted inserts:     " << millisecondsSince(start) << " (" << counted.size() << " nodes, "
+            << counted.bytesInUse() / 1024 << " KiB)" << std::endl;
+
+        start = Clock::now();
+        std::multiset<int> copies;
+        for (const int key : keys) {
+            copies.insert(key);
+        }
+        std::cout << "std::multiset:       " << millisecondsSince(start) << " (" << copies.size() << " nodes)" << std::endl;
+
+        start = Clock::now();
+        std::size_t found = 0;
+        for (int key = 0; key < 0x10000; key++) {
+            found += counted.count(key);
+        }
+        std::cout << "count, counted:      " << millisecondsSince(start) << " (" << found << ")" << std::endl;
+        start = Clock::now();
+        found = 0;
+        for (int key = 0; key < 0x10000; key++) {
+            found += copies.count(key);
+        }
+        std::cout << "count, std::multiset:" << millisecondsSince(start) << " (" << found << ")" << std::endl;
+    }
+
+    //Short ranges (up to about an hour of seconds) spread over a year, queried for a minute and for a day
+    void benchmarkIntervals(const std::size_t keyCount) {
+        constexpr int span = 365 * 24 * 3600;
+        std::mt19937 rng(19);
+        std::vector<Interval<int>> ranges(keyCount);
+        for (Interval<int>& range : ranges) {
+            range.start = static_cast<int>(rng() % span);
+            range.end = range.start + static_cast<int>(rng() % 3600);
+        }
+        IntervalTree tree;
+        Clock::time_point start = Clock::now();
+        for (const Interval<int>& range : ranges) {
+            tree.insert(range);
+        }
+        std::cout << "\n--- Intervals: " << tree.size() << " ranges (ms) ---" << std::endl;
+        std::cout << "insert:              " << millisecondsSince(start) << std::endl;
+
+        constexpr int queries = 1000;
+        for (const int width : {60, 24 * 3600}) {
+            start = Clock::now();
+            std::size_t found = 0;
+            for (int i = 0; i < queries; i++) {
+                const int lo = static_cast<int>(static_cast<long long>(i) * span / queries);
+                found += tree.overlapping(lo, lo + width, [](const Interval<int>&) {});
+            }
+            std::cout << std::left << std::setw(21) << std::to_string(queries) + " x " + std::to_string(width) + "s:"
+                << std::right << millisecondsSince(start) << " (" << found << " found)" << std::endl;
+        }
+
+        start = Clock::now();
+        std::size_t scanned = 0;
+        for (int i = 0; i < queries; i++) {
+            const int lo = static_cast<int>(static_cast<long long>(i) * span / queries);
+            scanned += std::count_if(ranges.begin(), ranges.end(),
+                                     [&](const Interval<int>& range) { return range.overlaps(lo, lo + 60); });
+        }
+        std::cout << "linear scan x 60s:   " << millisecondsSince(start) << " (" << scanned << " found)" << std::endl;
+    }
+
+    //print()'s old way of writing (an endl, so a flush, per node) against the buffered exporter, all into a file
+    void benchmarkExport(const std::size_t keyCount) {
+        const char* exportPath = "benchmark_export.txt";
+        RedBlackTree tree;
+        tree.insert_batch(randomKeys(keyCount, 17));
+        std::cout << "\n--- Export: " << tree.size() << " keys (ms) ---" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        {
+            std::ofstream out(exportPath);
+            const std::function<void(const Node*, int, bool)> printNode = [&](const Node* node, const int depth,
+                                                                              const bool isRight) {
+                if (node == nullptr) {
+                    return;
+                }
+                printNode(node->right, depth + 1, true);
+                for (int i = 0; i < depth; i++) {
+                    out << "    ";
+                }
+                if (depth > 0) {
+                    out << (isRight ? "Γ" : "L") << " ";
+                }
+                out << node->data << " (" << (node->color == RED ? "R" : "B") << ")" << std::endl;
+                printNode(node->left, depth + 1, false);
+            };
+            printNode(tree.root, 0, false);
+        }
+        std::cout << "endl per node:       " << millisecondsSince(start) << std::endl;
+
+        const std::pair<const char*, ExportFormat> formats[] = {
+            {"text:", ExportFormat::Text}, {"DOT:", ExportFormat::Dot}, {"JSON:", ExportFormat::Json}};
+        for (const auto& [name, format] : formats) {
+            start = Clock::now();
+            std::ofstream out(exportPath);
+            tree.exportTree(out, {format});
+            out.close();
+            std::cout << std::left << std::setw(21) << name << std::right << millisecondsSince(start) << std::endl;
+        }
+
+        std::remove(exportPath); //so truncating the big export isn't timed below
+
+        //about a thousand keys out of the middle
+        ExportOptions<int> range;
+        range.lower = 0;
+        range.upper = static_cast<int>(std::min<std::size_t>(keyCount, 1000) * (1ULL << 31) / std::max<std::size_t>(keyCount, 1));
+        start = Clock::now();
+        std::ofstream out(exportPath);
+        const std::size_t written = tree.exportTree(out, range);
+        out.close();
+        std::cout << "text, key range:     " << millisecondsSince(start) << " (" << written << " nodes)" << std::endl;
+        std::remove(exportPath);
+    }
+
+    //One lookup at a time against find_batch/contains_batch, on a tree built by random inserts (so nodes are scattered)
+    void benchmarkBatchLookups(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 11);
+        std::vector<int> probes = randomKeys(keyCount, 12); //about half hits, half misses
+        std::copy(keys.begin(), keys.begin() + keyCount / 2, probes.begin());
+        std::shuffle(probes.begin(), probes.end(), std::mt19937(13));
+        std::cout << "\n--- Batched lookups: " << keyCount << " random keys (ns per lookup) ---" << std::endl;
+
+        RedBlackTree tree;
+        for (const int key : keys) {
+            tree.insert(key);
+        }
+        const auto perLookup = [&](const Clock::time_point start) {
+            return millisecondsSince(start) * 1e6 / static_cast<double>(probes.size());
+        };
+
+        Clock::time_point start = Clock::now();
+        std::size_t found = 0;
+        for (const int probe : probes) {
+            found += tree.getNode(tree.root, probe) != nullptr ? 1 : 0;
+        }
+        std::cout << "getNode:             " << perLookup(start) << " (" << found << " found)" << std::endl;
+
+        start = Clock::now();
+        found = 0;
+        for (const int probe : probes) {
+            found += tree.find(probe) != tree.end() ? 1 : 0;
+        }
+        std::cout << "find:                " << perLookup(start) << " (" << found << " found)" << std::endl;
+
+        std::vector<RedBlackTree::iterator> results(probes.size());
+        start = Clock::now();
+        tree.find_batch(probes, results);
+        const double findBatchNs = perLookup(start);
+        found = static_cast<std::size_t>(std::count_if(results.begin(), results.end(),
+                                                       [&](const RedBlackTree::iterator it) { return it != tree.end(); }));
+        std::cout << "find_batch:          " << findBatchNs << " (" << found << " found)" << std::endl;
+
+        const std::unique_ptr<bool[]> contained(new bool[probes.size()]);
+        start = Clock::now();
+        found = tree.contains_batch(probes, std::span<bool>(contained.get(), probes.size()));
+        std::cout << "contains_batch:      " << perLookup(start) << " (" << found << " found)" << std::endl;
+    }
+
+    //Lookups in a frozen snapshot against pointer chasing in the tree and a binary search over a sorted array
+    void benchmarkFrozen(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 8);
+        std::vector<int> probes = randomKeys(keyCount, 9); //about half hits, half misses
+        std::copy(keys.begin(), keys.begin() + keyCount / 2, probes.begin());
+        std::shuffle(probes.begin(), probes.end(), std::mt19937(10));
+        std::cout << "\n--- Frozen snapshot: " << keyCount << " random keys (ns per lookup) ---" << std::endl;
+
+        RedBlackTree tree;
+        tree.insert_batch(keys);
+        Clock::time_point start = Clock::now();
+        FrozenTree frozen = tree.freeze();
+        std::cout << "freeze:              " << millisecondsSince(start) << " ms" << std::endl;
+        start = Clock::now();
+        frozen.assign(tree.begin(), tree.size());
+        std::cout << "refreeze:            " << millisecondsSince(start) << " ms (memory reused)" << std::endl;
+        const std::vector<int> sorted(tree.begin(), tree.end());
+
+        const auto time = [&](const char* name, const auto& lookup) {
+            const Clock::time_point lookupStart = Clock::now();
+            std::size_t found = 0;
+            for (const int probe : probes) {
+                found += lookup(probe) ? 1 : 0;
+            }
+            std::cout << std::left << std::setw(21) << name << std::right
+                << millisecondsSince(lookupStart) * 1e6 / static_cast<double>(probes.size()) << " (" << found
+                << " found)" << std::endl;
+        };
+        time("getNode:", [&](const int key) { return tree.getNode(tree.root, key) != nullptr; });
+        time("std::binary_search:", [&](const int key) { return std::binary_search(sorted.begin(), sorted.end(), key); });
+        time("frozen contains:", [&](const int key) { return frozen.contains(key); });
+        time("frozen lower_bound:", [&](const int key) { return frozen.lower_bound(key) != nullptr; });
+    }
+
+    //Per key cost of insert_batch/erase_batch against one insert or remove per key, on a tree that already holds keyCount keys
+    void benchmarkBatches(const std::size_t keyCount) {
+        const std::vector<int> keys = randomKeys(keyCount, 4);
+        std::cout << "\n--- Batched updates on " << keyCount << " keys (ns per key) ---" << std::endl;
+        std::cout << std::setw(10) << "batch" << std::setw(12) << "insert" << std::setw(14) << "insert_batch"
+            << std::setw(12) << "remove" << std::setw(14) << "erase_batch" << std::endl;
+
+        for (std::size_t batchSize = 1000; batchSize <= std::max<std::size_t>(keyCount, 1000); batchSize *= 10) {
+            const std::vector<int> batch = randomKeys(batchSize, static_cast<unsigned>(batchSize));
+            double perKey[4];
+
+            RedBlackTree single;
+            single.insert_batch(keys);
+            Clock::time_point start = Clock::now();
+            for (const int key : batch) {
+                single.insert(key);
+            }
+            perKey[0] = millisecondsSince(start);
+            start = Clock::now();
+            for (const int key : batch) {
+                single.erase(key);
+            }
+            perKey[2] = millisecondsSince(start);
+
+            RedBlackTree batched;
+            batched.insert_batch(keys);
+            start = Clock::now();
+            batched.insert_batch(batch);
+            perKey[1] = millisecondsSince(start);
+            start = Clock::now();
+            batched.erase_batch(batch);
+            perKey[3] = millisecondsSince(start);
+
+            const int widths[4] = {12, 14, 12, 14};
+            std::cout << std::setw(10) << batchSize;
+            for (int i = 0; i < 4; i++) {
+                std::cout << std::setw(widths[i]) << perKey[i] * 1e6 / static_cast<double>(batchSize);
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    //split at a key and join back, which only touches the search path (no copying)
+    void benchmarkSplitJoin(const std::size_t keyCount) {
+        std::vector<int> keys(keyCount);
+        for (std::size_t i = 0; i < keyCount; i++) {
+            keys[i] = static_cast<int>(i * 2);
+        }
+        RedBlackTree tree;
+        tree.assignSorted(keys.begin(), keys.end());
+        std::cout << "\n--- split + join on " << keyCount << " keys ---" << std::endl;
+
+        const std::size_t rounds = 100000;
+        std::mt19937 rng(5);
+        const Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < rounds; i++) {
+            const int key = static_cast<int>(rng() % (keyCount * 2 + 1));
+            auto [lower, found, upper] = tree.split(key);
+            tree = found ? RedBlackTree::join(std::move(lower), key, std::move(upper))
+                         : RedBlackTree::join2(std::move(lower), std::move(upper));
+        }
+        const double ms = millisecondsSince(start);
+        std::cout << "split + join:        " << ms * 1000 / rounds << " us each (" << tree.size() << " keys after)" << std::endl;
+    }
+
+    //set_union/intersection/difference on two trees, one thread against the pool, with a merge of the sorted keys as
+    //the baseline. Run once with two trees the same size and once with a much smaller second tree
+    void benchmarkSetOperations(const std::size_t keyCount) {
+        ThreadPool pool;
+        for (const std::size_t otherCount : {keyCount, keyCount / 100}) {
+            std::vector<int> aKeys = randomKeys(keyCount, 6);
+            std::vector<int> bKeys = randomKeys(otherCount, 7);
+            for (std::vector<int>* keys : {&aKeys, &bKeys}) {
+                for (int& key : *keys) {
+                    key &= 0x3FFFFFF; //smaller key range so the two sets overlap
+                }
+                std::sort(keys->begin(), keys->end());
+                keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+            }
+            std::cout << "\n--- Set operations on trees of " << keyCount << " and " << otherCount << " keys (ms, "
+                << pool.size() << " threads) ---" << std::endl;
+            std::cout << std::left << std::setw(14) << "operation" << std::right << std::setw(12) << "merge"
+                << std::setw(12) << "1 thread" << std::setw(12) << "pool" << std::setw(12) << "result" << std::endl;
+
+            const char* names[3] = {"union", "intersection", "difference"};
+            for (int operation = 0; operation < 3; operation++) {
+                const auto run = [&](ThreadPool* threads) {
+                    RedBlackTree a;
+                    RedBlackTree b;
+                    a.assignSorted(aKeys.begin(), aKeys.end());
+                    b.assignSorted(bKeys.begin(), bKeys.end());
+                    const Clock::time_point start = Clock::now();
+                    const RedBlackTree result = operation == 0 ? RedBlackTree::set_union(std::move(a), std::move(b), threads)
+                        : operation == 1 ? RedBlackTree::set_intersection(std::move(a), std::move(b), threads)
+                        : RedBlackTree::set_difference(std::move(a), std::move(b), threads);
+                    return std::make_pair(millisecondsSince(start), result.size());
+                };
+
+                //what reconciling looked like before: walk both trees, merge the keys and rebuild
+                RedBlackTree a;
+                RedBlackTree b;
+                a.assignSorted(aKeys.begin(), aKeys.end());
+                b.assignSorted(bKeys.begin(), bKeys.end());
+                const Clock::time_point start = Clock::now();
+                std::vector<int> merged;
+                if (operation == 0) {
+                    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged));
+                } else if (operation == 1) {
+                    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged));
+                } else {
+                    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged));
+                }
+                a.assignSorted(merged.begin(), merged.end());
+                const double mergeMs = millisecondsSince(start);
+
+                const auto [serialMs, resultSize] = run(nullptr);
+                const double parallelMs = run(&pool).first;
+                std::cout << std::left << std::setw(14) << names[operation] << std::right << std::setw(12) << mergeMs
+                    << std::setw(12) << serialMs << std::setw(12) << parallelMs << std::setw(12) << resultSize << std::endl;
+            }
+        }
+    }
+}
+
+void runBenchmarks(const std::size_t keyCount) {
+    std::cout << std::fixed << std::setprecision(2);
+    benchmarkCompactLayout(keyCount);
+    benchmarkRangeScan(keyCount);
+    benchmarkBatches(keyCount);
+    benchmarkSplitJoin(keyCount);
+    benchmarkSetOperations(keyCount);
+    benchmarkBatchLookups(keyCount);
+    benchmarkFrozen(keyCount);
+    benchmarkSnapshotFile(keyCount);
+    benchmarkJournal(keyCount);
+    benchmarkValidate(keyCount);
+    benchmarkExport(keyCount);
+    benchmarkMultiset(keyCount);
+    benchmarkIntervals(keyCount);
+    benchmarkConcurrent(keyCount);
+    benchmarkSnapshots(keyCount);
+    std::cout.unsetf(std::ios::floatfield);
+}
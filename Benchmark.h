@@ -0,0 +1,12 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+
+/**
+ * @brief Runs the built in benchmarks and prints the results
+ * @param keyCount How many keys each benchmark uses
+ */
+void runBenchmarks(std::size_t keyCount);
+
+#endif //BENCHMARK_H
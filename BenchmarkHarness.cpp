@@ -0,0 +1,431 @@
+/*
+ * Benchmark harness for tracking regressions: times RedBlackTree against std::set on several key distributions and
+ * sizes, and writes the results as JSON.
+ *
+ * Usage: rbt_bench [--sizes 1K,10K,100K,1M] [--distributions sequential,random,zipf,adversarial]
+ *                  [--zipf-exponent 0.99] [--seed 1] [--out results.json]
+ *
+ * Every (distribution, size) pair generates one sequence of keys. Each container then runs, in this order:
+ *  -bulk:   builds a new container from the sorted, deduplicated keys (assignSorted vs std::set's range constructor)
+ *  -insert: inserts the sequence one key at a time into an empty container
+ *  -search: looks up the sequence, every other probe shifted into a gap so about half of them miss
+ *  -scan:   walks every key in order
+ *  -erase:  erases the sequence one key at a time
+ * Throughput is over the whole phase. Latency percentiles come from timing a sample of the single key operations
+ * (they include the cost of reading the clock). Peak RSS is the process's high water mark since the case started
+ * (reset per case on Linux, otherwise it's the peak of the whole run).
+ */
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "RedBlackTree.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::vector<std::size_t> sizes{1000, 10000, 100000, 1000000};
+        std::vector<std::string> distributions{"sequential", "random", "zipf", "adversarial"};
+        double zipfExponent = 0.99;
+        unsigned seed = 1;
+        std::string outPath; //empty means stdout
+    };
+
+    struct Latencies {
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double p999 = 0;
+        double max = 0;
+    };
+
+    struct Result {
+        const char* container;
+        std::string distribution;
+        std::size_t keys;
+        const char* operation;
+        std::size_t ops;
+        double seconds;
+        std::optional<Latencies> latency; //only for single key operations
+        long peakRssKb;
+    };
+
+    /*
+     * Zipf sampler over ranks 1..n using rejection inversion (Hormann and Derflinger, 1996), so even 100M keys need no
+     * table of probabilities. Rank 1 is the most frequent.
+     */
+    class ZipfDistribution {
+    public:
+        ZipfDistribution(const std::size_t n, const double exponent) : n(static_cast<double>(n)), exponent(exponent) {
+            hIntegralX1 = hIntegral(1.5) - 1;
+            hIntegralN = hIntegral(this->n + 0.5);
+            s = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+        }
+
+        template <typename Rng>
+        std::size_t operator()(Rng& rng) {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            while (true) {
+                const double u = hIntegralN + uniform(rng) * (hIntegralX1 - hIntegralN);
+                const double x = hIntegralInverse(u);
+                const double k = std::clamp(std::floor(x + 0.5), 1.0, n);
+                if (k - x <= s || u >= hIntegral(k + 0.5) - h(k)) {
+                    return static_cast<std::size_t>(k);
+                }
+            }
+        }
+
+    private:
+        double h(const double x) const { return std::exp(-exponent * std::log(x)); }
+
+        double hIntegral(const double x) const {
+            const double logX = std::log(x);
+            return helper2((1 - exponent) * logX) * logX;
+        }
+
+        double hIntegralInverse(const double x) const {
+            const double t = std::max(-1.0, x * (1 - exponent));
+            return std::exp(helper1(t) * x);
+        }
+
+        //log1p(x) / x and expm1(x) / x, both 1 at x == 0
+        static double helper1(const double x) { return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x / 2; }
+        static double helper2(const double x) { return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x / 2; }
+
+        double n;
+        double exponent;
+        double hIntegralX1;
+        double hIntegralN;
+        double s;
+    };
+
+    /**
+     * @brief Builds the key sequence for a distribution. Keys are always even, so key + 1 is never in the container
+     * @param distribution sequential (ascending), random (shuffled), zipf (n draws, a few keys very often, so it has
+     * repeats), or adversarial (alternates the smallest and largest remaining key, so every insert lands at one end
+     * of the tree or the other and rebalances along both spines)
+     * @return The keys, empty if the distribution name is unknown
+     */
+    std::vector<int> makeKeys(const std::string& distribution, const std::size_t n, const Options& options) {
+        std::vector<int> keys(n);
+        std::mt19937_64 rng(options.seed);
+        if (distribution == "sequential") {
+            for (std::size_t i = 0; i < n; i++) {
+                keys[i] = static_cast<int>(2 * i);
+            }
+        } else if (distribution == "random") {
+            for (std::size_t i = 0; i < n; i++) {
+                keys[i] = static_cast<int>(2 * i);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+        } else if (distribution == "zipf") {
+            ZipfDistribution zipf(n, options.zipfExponent);
+            for (int& key : keys) {
+                //scatter the ranks over the key space, so the hot keys aren't all next to each other in the tree
+                const std::uint64_t rank = zipf(rng) - 1;
+                key = static_cast<int>(2 * (rank * 2654435761u % n));
+            }
+        } else if (distribution == "adversarial") {
+            std::size_t low = 0;
+            std::size_t high = n;
+            for (std::size_t i = 0; i < n; i++) {
+                keys[i] = static_cast<int>(2 * (i % 2 == 0 ? low++ : --high));
+            }
+        } else {
+            keys.clear();
+        }
+        return keys;
+    }
+
+    //Peak RSS in KiB since the last reset (or since the process started)
+    long peakRssKb() {
+#ifndef _WIN32
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024; //bytes on macOS
+#else
+        long peak = usage.ru_maxrss;
+#if defined(__linux__)
+        //ru_maxrss can't be reset, but VmHWM can (see resetPeakRss)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) {
+                peak = std::strtol(line.c_str() + 6, nullptr, 10);
+                break;
+            }
+        }
+#endif
+        return peak;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    void resetPeakRss() {
+#if defined(__linux__)
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5"; //resets VmHWM to the current RSS (Linux 4.0+, silently ignored if it isn't allowed)
+#endif
+    }
+
+    Latencies percentiles(std::vector<double>& samples) {
+        Latencies latency;
+        if (samples.empty()) {
+            return latency;
+        }
+        std::sort(samples.begin(), samples.end());
+        const auto at = [&](const double fraction) {
+            return samples[std::min(samples.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(samples.size())))];
+        };
+        latency.p50 = at(0.5);
+        latency.p90 = at(0.9);
+        latency.p99 = at(0.99);
+        latency.p999 = at(0.999);
+        latency.max = samples.back();
+        return latency;
+    }
+
+    //Runs op(key) on every key, timing one in every sampleEvery calls on its own
+    template <typename F>
+    std::pair<double, Latencies> timeEach(const std::vector<int>& keys, F&& op) {
+        const std::size_t sampleEvery = std::max<std::size_t>(1, keys.size() / 100000);
+        std::vector<double> samples;
+        samples.reserve(keys.size() / sampleEvery + 1);
+        const Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            if (i % sampleEvery == 0) {
+                const Clock::time_point opStart = Clock::now();
+                op(i, keys[i]);
+                samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - opStart).count());
+            } else {
+                op(i, keys[i]);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return {seconds, percentiles(samples)};
+    }
+
+    //Both containers behind the same calls
+    struct TreeAdapter {
+        static constexpr const char* name = "RedBlackTree";
+        RedBlackTree tree;
+
+        void bulk(const std::vector<int>& sorted) { tree.assignSorted(sorted.begin(), sorted.end()); }
+        void insert(const int key) { tree.insert(key); }
+        bool contains(const int key) const { return tree.find(key) != tree.end(); }
+
+        void erase(const int key) { tree.erase(key); }
+
+        long long scan() const {
+            long long sum = 0;
+            for (const int key : tree) {
+                sum += key;
+            }
+            return sum;
+        }
+    };
+
+    struct SetAdapter {
+        static constexpr const char* name = "std::set";
+        std::set<int> set;
+
+        void bulk(const std::vector<int>& sorted) { set = std::set<int>(sorted.begin(), sorted.end()); }
+        void insert(const int key) { set.insert(key); }
+        bool contains(const int key) const { return set.find(key) != set.end(); }
+        void erase(const int key) { set.erase(key); }
+
+        long long scan() const {
+            long long sum = 0;
+            for (const int key : set) {
+                sum += key;
+            }
+            return sum;
+        }
+    };
+
+    template <typename Container>
+    void runCase(const std::string& distribution, const std::vector<int>& keys, const std::vector<int>& sorted,
+                 std::vector<Result>& results) {
+        resetPeakRss();
+        volatile long long sink = 0; //keeps the lookups and the scan from being optimized away
+        const auto record = [&](const char* operation, const std::size_t ops, const double seconds,
+                                const std::optional<Latencies>& latency) {
+            results.push_back({Container::name, distribution, keys.size(), operation, ops, seconds, latency, peakRssKb()});
+        };
+
+        {
+            Container bulk;
+            const Clock::time_point start = Clock::now();
+            bulk.bulk(sorted);
+            record("bulk", sorted.size(), std::chrono::duration<double>(Clock::now() - start).count(), std::nullopt);
+        }
+
+        Container container;
+        auto [seconds, latency] = timeEach(keys, [&](std::size_t, const int key) { container.insert(key); });
+        record("insert", keys.size(), seconds, latency);
+
+        std::size_t found = 0;
+        std::tie(seconds, latency) = timeEach(keys, [&](const std::size_t i, const int key) {
+            found += container.contains(key + static_cast<int>(i & 1)) ? 1 : 0;
+        });
+        sink = sink + static_cast<long long>(found);
+        record("search", keys.size(), seconds, latency);
+
+        const Clock::time_point start = Clock::now();
+        sink = sink + container.scan();
+        record("scan", sorted.size(), std::chrono::duration<double>(Clock::now() - start).count(), std::nullopt);
+
+        std::tie(seconds, latency) = timeEach(keys, [&](std::size_t, const int key) { container.erase(key); });
+        record("erase", keys.size(), seconds, latency);
+    }
+
+    void writeJson(std::ostream& out, const std::vector<Result>& results) {
+        out << "{\n  \"benchmark\": \"red_black_tree\",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"container\": \"" << result.container << "\", \"distribution\": \""
+                << result.distribution << "\", \"keys\": " << result.keys << ", \"operation\": \"" << result.operation
+                << "\", \"ops\": " << result.ops << ", \"seconds\": " << result.seconds << ", \"ops_per_sec\": "
+                << (result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds : 0) << ", \"latency_ns\": ";
+            if (result.latency) {
+                out << "{\"p50\": " << result.latency->p50 << ", \"p90\": " << result.latency->p90 << ", \"p99\": "
+                    << result.latency->p99 << ", \"p999\": " << result.latency->p999 << ", \"max\": "
+                    << result.latency->max << "}";
+            } else {
+                out << "null";
+            }
+            out << ", \"peak_rss_kb\": " << result.peakRssKb << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    std::vector<std::string> splitList(const std::string& list) {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    //"1000", "10K", "100M"
+    std::optional<std::size_t> parseSize(const std::string& text) {
+        char* end = nullptr;
+        const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+        if (end == text.c_str()) {
+            return std::nullopt;
+        }
+        const std::string suffix(end);
+        if (suffix.empty()) {
+            return value;
+        }
+        if (suffix == "K" || suffix == "k") {
+            return value * 1000;
+        }
+        if (suffix == "M" || suffix == "m") {
+            return value * 1000000;
+        }
+        return std::nullopt;
+    }
+
+    bool parseOptions(const int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << std::endl;
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (flag == "--sizes") {
+                options.sizes.clear();
+                for (const std::string& item : splitList(value)) {
+                    const std::optional<std::size_t> size = parseSize(item);
+                    //keys are 2 * index, so they have to fit in an int
+                    if (!size || *size == 0 || *size > static_cast<std::size_t>(INT_MAX / 2)) {
+                        std::cerr << "Invalid size: " << item << std::endl;
+                        return false;
+                    }
+                    options.sizes.push_back(*size);
+                }
+            } else if (flag == "--distributions") {
+                options.distributions = splitList(value);
+            } else if (flag == "--zipf-exponent") {
+                options.zipfExponent = std::strtod(value.c_str(), nullptr);
+                if (options.zipfExponent <= 0) {
+                    std::cerr << "The Zipf exponent has to be positive" << std::endl;
+                    return false;
+                }
+            } else if (flag == "--seed") {
+                options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            } else if (flag == "--out") {
+                options.outPath = value;
+            } else {
+                std::cerr << "Unknown option " << flag << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(const int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 1K,10K,100K,1M] [--distributions "
+            "sequential,random,zipf,adversarial] [--zipf-exponent 0.99] [--seed 1] [--out results.json]" << std::endl;
+        return 2;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& distribution : options.distributions) {
+        for (const std::size_t size : options.sizes) {
+            const std::vector<int> keys = makeKeys(distribution, size, options);
+            if (keys.empty()) {
+                std::cerr << "Unknown distribution " << distribution << std::endl;
+                return 2;
+            }
+            std::vector<int> sorted = keys;
+            std::sort(sorted.begin(), sorted.end());
+            sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+            std::cerr << distribution << " " << size << " keys..." << std::endl; //progress, stdout may be the JSON
+            runCase<TreeAdapter>(distribution, keys, sorted, results);
+            runCase<SetAdapter>(distribution, keys, sorted, results);
+        }
+    }
+
+    if (options.outPath.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream out(options.outPath);
+        if (!out) {
+            std::cerr << "Cannot write " << options.outPath << std::endl;
+            return 1;
+        }
+        writeJson(out, results);
+    }
+    return 0;
+}
@@ -0,0 +1,6 @@
+#include "CompactRedBlackTree.h"
+
+//Compile the int tree once here
+template class BasicCompactRedBlackTree<int>;
+
+static_assert(sizeof(CompactNode<int>) == 16, "compact int nodes should be 16 bytes");
@@ -0,0 +1,169 @@
+#ifndef COMPACTREDBLACKTREE_H
+#define COMPACTREDBLACKTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "RedBlackTree.h"
+
+/*
+ * Compact node: links are 32-bit indices into the tree's node array instead of 8-byte pointers,
+ * and the color is the top bit of the parent index. With an int key that's 16 bytes a node (vs 40 for Node).
+ */
+template <typename Key>
+struct CompactNode {
+    static constexpr std::uint32_t nil = 0x7FFFFFFF; //"null" index (the top bit is taken by the color)
+    static constexpr std::uint32_t colorBit = 0x80000000;
+
+    Key data; //key stored in node
+    std::uint32_t left = nil; //left will be index 0
+    std::uint32_t right = nil; //right will be index 1
+    std::uint32_t parentAndColor = nil; //parent index in the low 31 bits, set top bit means BLACK (nodes start RED)
+
+    std::uint32_t parent() const { return parentAndColor & nil; }
+    void setParent(const std::uint32_t index) { parentAndColor = (parentAndColor & colorBit) | index; }
+
+    Color color() const { return (parentAndColor & colorBit) != 0 ? BLACK : RED; }
+    void setColor(const Color color) { parentAndColor = (parentAndColor & nil) | (color == BLACK ? colorBit : 0); }
+
+    /**
+     * @brief Retrieves a child index by direction (0 for left, 1 for right)
+     */
+    std::uint32_t child(const int index) const { return index == 0 ? left : right; }
+
+    /**
+     * @brief Sets a child index by direction (0 for left, 1 for right)
+     */
+    void setChild(const int index, const std::uint32_t node) {
+        if (index == 0) {
+            left = node;
+        } else {
+            right = node;
+        }
+    }
+};
+
+
+/*
+ * Red-Black tree with every node stored in one contiguous array (see CompactNode).
+ * Same algorithms as BasicRedBlackTree, but every "pointer" is an index. Removed slots go on a free list
+ * (linked through their left index) and get reused by the next insert. Holds up to 2^31 - 1 nodes.
+ */
+template <typename Key, typename Compare = std::less<Key>>
+class BasicCompactRedBlackTree {
+public:
+    using Node = CompactNode<Key>;
+    static constexpr std::uint32_t nil = Node::nil;
+
+    BasicCompactRedBlackTree() = default;
+
+    /**
+     * @brief Inserts a key
+     * @param data Key to insert
+     * @return true if it was inserted, false if it was already in the tree
+     */
+    bool insert(const Key& data);
+
+    /**
+     * @brief Removes a key
+     * @param data Key to remove
+     * @return true if it was removed, false if it wasn't in the tree
+     */
+    bool remove(const Key& data);
+
+    /**
+     * @brief Searches for a node with the specified key
+     * @param data The key to search for
+     * @return Index of the node, nil if it's not in the tree
+     */
+    std::uint32_t getNode(const Key& data) const;
+
+    bool contains(const Key& data) const { return getNode(data) != nil; }
+
+    /**
+     * @brief Rotates a subtree around a pivot node in the specified direction
+     * @param subRoot Index of the root of the subtree to rotate
+     * @param dir The direction to rotate (left or right)
+     * @return Index of the new subtree root after rotation
+     */
+    std::uint32_t rotateSubTree(std::uint32_t subRoot, direction dir);
+
+    /**
+     * @brief Replaces one subtree with another
+     * @param u Index of the subtree to be replaced
+     * @param v Index of the subtree that replaces u (may be nil)
+     */
+    void transplant(std::uint32_t u, std::uint32_t v);
+
+    /**
+     * @brief Rebalances the tree after inserting a (red) node
+     * @param node Index of the newly inserted node
+     */
+    void insertBalance(std::uint32_t node);
+
+    /**
+     * @brief Rebalances the tree after removing a black node
+     * @param parent Index of the parent of the subtree that is one black node short
+     * @param dir Which child of parent is short
+     */
+    void removeBalance(std::uint32_t parent, direction dir);
+
+    /**
+     * @brief Finds the minimum node in a subtree
+     * @param node Index of the root of the subtree
+     * @return Index of the node with the minimum key
+     */
+    std::uint32_t tree_min(std::uint32_t node) const;
+
+    /**
+     * @brief Calls fn with every key in order (no recursion)
+     */
+    template <typename F>
+    void forEach(F&& fn) const;
+
+    /**
+     * @brief Checks every Red-Black property and prints the result
+     * @return true if the tree is valid
+     */
+    bool checkTree() const;
+
+    /**
+     * @brief Reserves room in the node array so the next count inserts don't reallocate
+     */
+    void reserve(std::size_t count) { nodes.reserve(nodes.size() - freeCount + count); }
+
+    /**
+     * @brief Removes every node
+     */
+    void clear();
+
+    std::size_t size() const { return nodeCount; }
+    bool empty() const { return nodeCount == 0; }
+    std::size_t bytesInUse() const { return nodeCount * sizeof(Node); }
+    std::size_t bytesReserved() const { return nodes.capacity() * sizeof(Node); }
+
+    const Node& node(const std::uint32_t index) const { return nodes[index]; }
+
+    std::uint32_t root = nil; //index of the root
+
+private:
+    Color getColor(std::uint32_t index) const { return index == nil ? BLACK : nodes[index].color(); }
+    direction nodeDirection(std::uint32_t index) const;
+    std::uint32_t allocate(const Key& data);
+    void release(std::uint32_t index);
+    int checkTreeProperties(std::uint32_t parent, std::uint32_t node, bool& valid) const;
+
+    std::vector<Node> nodes;
+    std::uint32_t freeList = nil; //removed slots, linked through their left index
+    std::size_t freeCount = 0;
+    std::size_t nodeCount = 0;
+    [[no_unique_address]] Compare compare;
+};
+
+#include "CompactRedBlackTree.tpp"
+
+extern template class BasicCompactRedBlackTree<int>;
+using CompactRedBlackTree = BasicCompactRedBlackTree<int>;
+
+#endif //COMPACTREDBLACKTREE_H
@@ -0,0 +1,352 @@
+//Definitions for BasicCompactRedBlackTree (included at the bottom of CompactRedBlackTree.h, don't include this directly)
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#define CRBT_TEMPLATE template <typename Key, typename Compare>
+#define CRBT_CLASS BasicCompactRedBlackTree<Key, Compare>
+
+CRBT_TEMPLATE
+std::uint32_t CRBT_CLASS::allocate(const Key& data) {
+    std::uint32_t index;
+    if (freeList != nil) {
+        index = freeList;
+        freeList = nodes[index].left;
+        freeCount--;
+        nodes[index] = Node{data};
+    } else {
+        if (nodes.size() >= nil) {
+            throw std::length_error("CompactRedBlackTree is full (2^31 - 1 nodes)");
+        }
+        index = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back(Node{data});
+    }
+    nodeCount++;
+    return index;
+}
+
+CRBT_TEMPLATE
+void CRBT_CLASS::release(const std::uint32_t index) {
+    nodes[index].left = freeList;
+    freeList = index;
+    freeCount++;
+    nodeCount--;
+}
+
+CRBT_TEMPLATE
+direction CRBT_CLASS::nodeDirection(const std::uint32_t index) const {
+    return nodes[nodes[index].parent()].right == index ? right : left;
+}
+
+CRBT_TEMPLATE
+std::uint32_t CRBT_CLASS::tree_min(std::uint32_t node) const {
+    while (nodes[node].left != nil) {
+        node = nodes[node].left;
+    }
+    return node;
+}
+
+//Same as the pointer version: the subRoot's opposite child becomes the new root and takes over the subRoot's place
+CRBT_TEMPLATE
+std::uint32_t CRBT_CLASS::rotateSubTree(const std::uint32_t subRoot, const direction dir) {
+    const std::uint32_t parent = nodes[subRoot].parent();
+    const std::uint32_t newRoot = nodes[subRoot].child(1 - dir);
+    const std::uint32_t newChild = nodes[newRoot].child(dir); //the 'inner' child that switches sides
+
+    nodes[subRoot].setChild(1 - dir, newChild);
+    if (newChild != nil) {
+        nodes[newChild].setParent(subRoot);
+    }
+
+    nodes[newRoot].setChild(dir, subRoot);
+    nodes[newRoot].setParent(parent);
+    nodes[subRoot].setParent(newRoot);
+
+    if (parent != nil) {
+        nodes[parent].setChild(nodes[parent].right == subRoot, newRoot);
+    } else {
+        root = newRoot;
+    }
+    return newRoot;
+}
+
+CRBT_TEMPLATE
+void CRBT_CLASS::transplant(const std::uint32_t u, const std::uint32_t v) {
+    const std::uint32_t parent = nodes[u].parent();
+    if (parent == nil) {
+        root = v;
+    } else {
+        nodes[parent].setChild(nodeDirection(u), v);
+    }
+    if (v != nil) {
+        nodes[v].setParent(parent);
+    }
+}
+
+CRBT_TEMPLATE
+bool CRBT_CLASS::insert(const Key& data) {
+    std::uint32_t parent = nil;
+    std::uint32_t pos = root;
+    direction dir = right;
+
+    while (pos != nil) {
+        parent = pos;
+        if (compare(data, nodes[pos].data)) {
+            dir = left;
+        } else if (compare(nodes[pos].data, data)) {
+            dir = right;
+        } else {
+            return false; //already in the tree
+        }
+        pos = nodes[pos].child(dir);
+    }
+
+    const std::uint32_t node = allocate(data); //may reallocate nodes, so no references are held across this
+    nodes[node].setParent(parent);
+    if (parent == nil) {
+        root = node;
+    } else {
+        nodes[parent].setChild(dir, node);
+    }
+    insertBalance(node);
+    return true;
+}
+
+//Cases are numbered the same way as BasicRedBlackTree::insertBalance
+CRBT_TEMPLATE
+void CRBT_CLASS::insertBalance(std::uint32_t node) {
+    while (true) {
+        const std::uint32_t parent = nodes[node].parent();
+        if (parent == nil) {
+            nodes[node].setColor(BLACK); //node is the root
+            return;
+        }
+        //Case 1
+        if (nodes[parent].color() == BLACK) {
+            return;
+        }
+        //Case 4: parent is red and the root
+        const std::uint32_t grandparent = nodes[parent].parent();
+        if (grandparent == nil) {
+            nodes[parent].setColor(BLACK);
+            return;
+        }
+
+        const direction dir = nodeDirection(parent);
+        const std::uint32_t uncle = nodes[grandparent].child(1 - dir);
+
+        //Case 2: parent and uncle are red, push the red up to the grandparent and keep going
+        if (getColor(uncle) == RED) {
+            nodes[parent].setColor(BLACK);
+            nodes[uncle].setColor(BLACK);
+            nodes[grandparent].setColor(RED);
+            node = grandparent;
+            continue;
+        }
+
+        //Case 5: inner child, rotate it to the outside first
+        std::uint32_t top = parent;
+        if (node == nodes[parent].child(1 - dir)) {
+            rotateSubTree(parent, dir);
+            top = node;
+        }
+
+        //Case 6
+        rotateSubTree(grandparent, static_cast<direction>(1 - dir));
+        nodes[top].setColor(BLACK);
+        nodes[grandparent].setColor(RED);
+        return;
+    }
+}
+
+CRBT_TEMPLATE
+bool CRBT_CLASS::remove(const Key& data) {
+    const std::uint32_t toRemove = getNode(data);
+    if (toRemove == nil) {
+        return false;
+    }
+
+    std::uint32_t x; //node that moves into the removed position (may be nil)
+    std::uint32_t xParent;
+    direction xDir;
+    Color originalColor = nodes[toRemove].color();
+
+    if (nodes[toRemove].left == nil || nodes[toRemove].right == nil) {
+        //at most one child, replace the node with it
+        x = nodes[toRemove].left != nil ? nodes[toRemove].left : nodes[toRemove].right;
+        xParent = nodes[toRemove].parent();
+        xDir = xParent != nil ? nodeDirection(toRemove) : right;
+        transplant(toRemove, x);
+    } else {
+        //two children, the in order successor takes its place
+        const std::uint32_t y = tree_min(nodes[toRemove].right);
+        originalColor = nodes[y].color();
+        x = nodes[y].right;
+
+        if (nodes[y].parent() == toRemove) {
+            xParent = y;
+            xDir = right;
+        } else {
+            xParent = nodes[y].parent();
+            xDir = left; //the successor is always a left child unless it's toRemove's direct child
+            transplant(y, x);
+            nodes[y].right = nodes[toRemove].right;
+            nodes[nodes[y].right].setParent(y);
+        }
+
+        transplant(toRemove, y);
+        nodes[y].left = nodes[toRemove].left;
+        nodes[nodes[y].left].setParent(y);
+        nodes[y].setColor(nodes[toRemove].color());
+    }
+    release(toRemove);
+
+    if (originalColor == BLACK) {
+        if (getColor(x) == RED) {
+            nodes[x].setColor(BLACK); //a red replacement just takes over the black
+        } else if (xParent != nil) {
+            removeBalance(xParent, xDir);
+        }
+    }
+    return true;
+}
+
+//The subtree at parent->child(dir) has one less black node than its sibling. Cases are numbered like BasicRedBlackTree::removeBalance
+CRBT_TEMPLATE
+void CRBT_CLASS::removeBalance(std::uint32_t parent, direction dir) {
+    while (parent != nil) {
+        std::uint32_t sibling = nodes[parent].child(1 - dir);
+
+        //Case 3: red sibling, rotate so the sibling is black
+        if (getColor(sibling) == RED) {
+            rotateSubTree(parent, dir);
+            nodes[parent].setColor(RED);
+            nodes[sibling].setColor(BLACK);
+            sibling = nodes[parent].child(1 - dir);
+        }
+
+        std::uint32_t closeNephew = nodes[sibling].child(dir);
+        std::uint32_t farNephew = nodes[sibling].child(1 - dir);
+
+        if (getColor(closeNephew) == BLACK && getColor(farNephew) == BLACK) {
+            nodes[sibling].setColor(RED);
+            //Case 4: red parent absorbs the missing black
+            if (nodes[parent].color() == RED) {
+                nodes[parent].setColor(BLACK);
+                return;
+            }
+            //Case 2: the whole parent subtree is short now, move up
+            const std::uint32_t current = parent;
+            parent = nodes[current].parent();
+            if (parent != nil) {
+                dir = nodeDirection(current);
+            }
+            continue;
+        }
+
+        //Case 5: close nephew red, far nephew black
+        if (getColor(farNephew) == BLACK) {
+            rotateSubTree(sibling, static_cast<direction>(1 - dir));
+            nodes[sibling].setColor(RED);
+            nodes[closeNephew].setColor(BLACK);
+            farNephew = sibling;
+            sibling = closeNephew;
+        }
+
+        //Case 6: far nephew red
+        rotateSubTree(parent, dir);
+        nodes[sibling].setColor(nodes[parent].color());
+        nodes[parent].setColor(BLACK);
+        nodes[farNephew].setColor(BLACK);
+        return;
+    }
+}
+
+CRBT_TEMPLATE
+std::uint32_t CRBT_CLASS::getNode(const Key& data) const {
+    std::uint32_t pos = root;
+    while (pos != nil) {
+        if (compare(data, nodes[pos].data)) {
+            pos = nodes[pos].left;
+        } else if (compare(nodes[pos].data, data)) {
+            pos = nodes[pos].right;
+        } else {
+            return pos;
+        }
+    }
+    return nil;
+}
+
+//In order walk that climbs back up through the parent indices (no stack needed)
+CRBT_TEMPLATE
+template <typename F>
+void CRBT_CLASS::forEach(F&& fn) const {
+    if (root == nil) {
+        return;
+    }
+    std::uint32_t pos = tree_min(root);
+    while (pos != nil) {
+        fn(nodes[pos].data);
+        if (nodes[pos].right != nil) {
+            pos = tree_min(nodes[pos].right);
+        } else {
+            std::uint32_t parent = nodes[pos].parent();
+            while (parent != nil && nodes[parent].right == pos) {
+                pos = parent;
+                parent = nodes[parent].parent();
+            }
+            pos = parent;
+        }
+    }
+}
+
+CRBT_TEMPLATE
+int CRBT_CLASS::checkTreeProperties(const std::uint32_t parent, const std::uint32_t node, bool& valid) const {
+    if (node == nil) {
+        return 1;
+    }
+    const Node& n = nodes[node];
+    if (n.parent() != parent) {
+        valid = false;
+    }
+    if (n.color() == RED && getColor(parent) == RED && parent != nil) {
+        valid = false; //red-red violation
+    }
+    if ((n.left != nil && !compare(nodes[n.left].data, n.data)) || (n.right != nil && !compare(n.data, nodes[n.right].data))) {
+        valid = false; //out of order
+    }
+    const int leftHeight = checkTreeProperties(node, n.left, valid);
+    const int rightHeight = checkTreeProperties(node, n.right, valid);
+    if (leftHeight != rightHeight) {
+        valid = false;
+    }
+    return leftHeight + (n.color() == BLACK ? 1 : 0);
+}
+
+CRBT_TEMPLATE
+bool CRBT_CLASS::checkTree() const {
+    if (root == nil) {
+        std::cout << "Tree is empty" << std::endl;
+        return true;
+    }
+    bool valid = nodes[root].color() == BLACK;
+    const int blackHeight = checkTreeProperties(nil, root, valid);
+    if (valid) {
+        std::cout << "Compact tree passes RBT validation with black height: " << blackHeight << std::endl;
+    } else {
+        std::cout << "Compact tree FAILS RBT validation" << std::endl;
+    }
+    return valid;
+}
+
+CRBT_TEMPLATE
+void CRBT_CLASS::clear() {
+    nodes.clear();
+    root = nil;
+    freeList = nil;
+    freeCount = 0;
+    nodeCount = 0;
+}
+
+#undef CRBT_TEMPLATE
+#undef CRBT_CLASS
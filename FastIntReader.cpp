@@ -0,0 +1,89 @@
+#include "FastIntReader.h"
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+InputBuffer::~InputBuffer() {
+    close();
+}
+
+bool InputBuffer::open(const std::string& path) {
+    close();
+
+    if (path == "-") {
+        return readAll(stdin); //goes through stdio, so anything std::cin already buffered isn't lost
+    }
+
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            madvise(view, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL); //it's read front to back once
+            bytes = static_cast<const char*>(view);
+            length = static_cast<std::size_t>(info.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd); //the mapping stays valid after the descriptor is closed
+    if (mapped) {
+        return true;
+    }
+#endif
+
+    //pipes, empty files, Windows, or mmap failed
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool ok = readAll(file);
+    std::fclose(file);
+    return ok;
+}
+
+//Reads everything with big reads, doubling the block size as it goes
+bool InputBuffer::readAll(std::FILE* file) {
+    std::size_t block = std::size_t(1) << 20;
+    std::size_t used = 0;
+    while (true) {
+        buffer.resize(used + block);
+        const std::size_t got = std::fread(buffer.data() + used, 1, block, file);
+        used += got;
+        if (got < block) {
+            if (std::ferror(file)) {
+                buffer.clear();
+                return false;
+            }
+            break;
+        }
+        if (block < (std::size_t(1) << 26)) {
+            block *= 2;
+        }
+    }
+    buffer.resize(used);
+    bytes = buffer.data();
+    length = used;
+    return true;
+}
+
+void InputBuffer::close() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+    buffer.clear();
+    buffer.shrink_to_fit();
+}
@@ -0,0 +1,171 @@
+#ifndef FASTINTREADER_H
+#define FASTINTREADER_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define FASTINTREADER_SSE2 1
+#endif
+
+/*
+ * Read only view of a whole input.
+ *  -Regular files are memory mapped, so nothing gets copied (the scanner reads straight from the page cache).
+ *  -stdin ("-"), pipes and anything that can't be mapped are read into a buffer with big reads instead.
+ */
+class InputBuffer {
+public:
+    InputBuffer() = default;
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+    ~InputBuffer();
+
+    /**
+     * @brief Opens an input (closing any previous one)
+     * @param path Path of the file, or "-" for stdin
+     * @return false if it couldn't be opened
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmaps/frees the input
+     */
+    void close();
+
+    const char* begin() const { return bytes; }
+    const char* end() const { return bytes + length; }
+    std::size_t size() const { return length; }
+    bool isMapped() const { return mapped; } //true if the input is memory mapped, false if it was read into a buffer
+
+private:
+    bool readAll(std::FILE* file);
+
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+    std::vector<char> buffer; //used when the input couldn't be mapped
+};
+
+//What the scanner skipped while reading
+struct ScanResult {
+    std::size_t invalid = 0; //tokens that weren't integers
+    std::size_t overflow = 0; //integers that don't fit in an int
+};
+
+/**
+ * @brief Checks if a byte separates numbers (space, newline, tab, carriage return and every other control character)
+ */
+inline bool isSeparator(const char c) {
+    return static_cast<unsigned char>(c) <= ' ';
+}
+
+namespace detail {
+    //Skips the separators at the start of [pos, end), 16 bytes at a time when SSE2 is available
+    inline const char* skipSeparators(const char* pos, const char* end) {
+#ifdef FASTINTREADER_SSE2
+        const __m128i space = _mm_set1_epi8(' ');
+        while (end - pos >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            //a byte is a separator if min(byte, ' ') == byte (unsigned)
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk)));
+            if (mask != 0xFFFF) {
+                return pos + __builtin_ctz(~mask);
+            }
+            pos += 16;
+        }
+#endif
+        while (pos < end && isSeparator(*pos)) {
+            pos++;
+        }
+        return pos;
+    }
+
+    //End of the run of digits that starts at pos
+    inline const char* skipDigits(const char* pos, const char* end) {
+#ifdef FASTINTREADER_SSE2
+        const __m128i zero = _mm_set1_epi8('0');
+        const __m128i nine = _mm_set1_epi8(9);
+        while (end - pos >= 16) {
+            const __m128i chunk = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)), zero);
+            //a byte is a digit if (byte - '0') <= 9 (unsigned)
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, nine), chunk)));
+            if (mask != 0xFFFF) {
+                return pos + __builtin_ctz(~mask);
+            }
+            pos += 16;
+        }
+#endif
+        while (pos < end && static_cast<unsigned char>(*pos - '0') <= 9) {
+            pos++;
+        }
+        return pos;
+    }
+}
+
+/**
+ * @brief Parses separator delimited integers in [begin, end) without any locale or stream machinery
+ * Numbers are an optional + or - followed by digits. Tokens that aren't numbers, and numbers that don't fit in an
+ * int, are skipped and counted in result.
+ * @param begin Start of the text
+ * @param end End of the text
+ * @param onNumber Called with every int that's found
+ * @param result Counts of skipped tokens (added to, not reset)
+ */
+template <typename Callback>
+void scanInts(const char* begin, const char* end, Callback&& onNumber, ScanResult& result) {
+    const char* pos = begin;
+    while (true) {
+        pos = detail::skipSeparators(pos, end);
+        if (pos == end) {
+            return;
+        }
+
+        const bool negative = *pos == '-';
+        if (*pos == '-' || *pos == '+') {
+            pos++;
+        }
+        const char* digits = pos;
+        pos = detail::skipDigits(pos, end);
+
+        if (pos == digits || (pos != end && !isSeparator(*pos))) {
+            //not a number, skip the rest of the token
+            result.invalid++;
+            while (pos != end && !isSeparator(*pos)) {
+                pos++;
+            }
+            continue;
+        }
+
+        while (digits + 1 < pos && *digits == '0') {
+            digits++; //leading zeros don't count towards the length check
+        }
+        if (pos - digits > 10) {
+            result.overflow++;
+            continue;
+        }
+        std::uint64_t value = 0;
+        for (const char* d = digits; d != pos; d++) {
+            value = value * 10 + static_cast<unsigned>(*d - '0');
+        }
+        //INT_MIN has one more unit of magnitude than INT_MAX
+        if (value > static_cast<std::uint64_t>(INT_MAX) + (negative ? 1 : 0)) {
+            result.overflow++;
+            continue;
+        }
+        onNumber(negative ? static_cast<int>(-static_cast<std::int64_t>(value)) : static_cast<int>(value));
+    }
+}
+
+/**
+ * @brief Convenience wrapper that appends every int in [begin, end) to a vector
+ */
+inline void scanInts(const char* begin, const char* end, std::vector<int>& out, ScanResult& result) {
+    scanInts(begin, end, [&out](const int num) { out.push_back(num); }, result);
+}
+
+#endif //FASTINTREADER_H
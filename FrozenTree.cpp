@@ -0,0 +1,4 @@
+#include "FrozenTree.h"
+
+//Compile the int snapshot once here
+template class BasicFrozenTree<int>;
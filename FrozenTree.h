@@ -0,0 +1,89 @@
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <vector>
+
+//Allocator that puts every array on its own cache line (so a block of keys never straddles two lines)
+template <typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+    static constexpr std::size_t alignment = 64;
+
+    CacheAlignedAllocator() = default;
+
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) noexcept {
+    }
+
+    T* allocate(const std::size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{alignment}));
+    }
+
+    void deallocate(T* memory, std::size_t) noexcept {
+        ::operator delete(memory, std::align_val_t{alignment});
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const noexcept { return true; }
+};
+
+
+/*
+ * Read only copy of a tree's keys in Eytzinger (BFS) order, for phases that do nothing but look keys up.
+ *  -The keys sit in one array: the root at index 1, and the children of index k at 2k and 2k + 1. There are no
+ *   pointers to chase, and the top levels of the tree share a handful of cache lines that stay hot.
+ *  -Searching is branchless (every step is k = 2k + (key is bigger)), so there are no branch mispredictions to pay for.
+ *  -The 16 descendants four levels below index k are next to each other (for 4-byte keys that's one cache line), so
+ *   every step prefetches the line it will need four steps later and most of the misses overlap.
+ * Building one is O(n) (one in order walk), and assign() reuses the memory, so it's cheap to rebuild after writes.
+ */
+template <typename Key, typename Compare = std::less<Key>>
+class BasicFrozenTree {
+public:
+    BasicFrozenTree() = default;
+    explicit BasicFrozenTree(const Compare& compare) : compare(compare) {
+    }
+
+    /**
+     * @brief Replaces the contents with count keys read in order from first (no tree needed, any input iterator works)
+     * @param first Start of the keys (must be sorted by the comparator, with no duplicates)
+     * @param count Number of keys to read
+     */
+    template <typename InputIt>
+    void assign(InputIt first, std::size_t count);
+
+    /**
+     * @brief Finds the first key that is not less than key
+     * @param key The key to search for
+     * @return Pointer to that key, nullptr if every key is less
+     */
+    const Key* lower_bound(const Key& key) const;
+
+    /**
+     * @brief Checks if a key is in the snapshot
+     */
+    bool contains(const Key& key) const;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t bytesReserved() const { return keys.capacity() * sizeof(Key); }
+
+private:
+    //keys per cache line, so index k * blockSize is where k's descendants four levels down start (for 4-byte keys)
+    static constexpr std::size_t blockSize = sizeof(Key) < CacheAlignedAllocator<Key>::alignment
+                                                 ? CacheAlignedAllocator<Key>::alignment / sizeof(Key) : 1;
+
+    std::vector<Key, CacheAlignedAllocator<Key>> keys; //keys[0] is unused so the root can be at 1
+    std::size_t count = 0;
+    [[no_unique_address]] Compare compare;
+};
+
+#include "FrozenTree.tpp"
+
+extern template class BasicFrozenTree<int>;
+using FrozenTree = BasicFrozenTree<int>;
+
+#endif //FROZENTREE_H
@@ -0,0 +1,62 @@
+//Definitions for BasicFrozenTree (included at the bottom of FrozenTree.h, don't include this directly)
+#include <bit>
+#include <cstdint>
+
+#define FT_TEMPLATE template <typename Key, typename Compare>
+#define FT_CLASS BasicFrozenTree<Key, Compare>
+
+FT_TEMPLATE
+template <typename InputIt>
+void FT_CLASS::assign(InputIt first, const std::size_t count) {
+    keys.resize(count + 1); //keeps the old capacity, so rebuilding a snapshot of the same size doesn't allocate
+    this->count = count;
+    if (count == 0) {
+        return;
+    }
+
+    //in order walk over the implicit tree, starting at the leftmost index
+    std::size_t k = 1;
+    while (2 * k <= count) {
+        k *= 2;
+    }
+    for (std::size_t i = 0; i < count; i++, ++first) {
+        keys[k] = *first;
+        if (2 * k + 1 <= count) {
+            //next is the leftmost index in the right subtree
+            k = 2 * k + 1;
+            while (2 * k <= count) {
+                k *= 2;
+            }
+        } else {
+            //next is the first ancestor we are in the left subtree of (climb past every right child, then one more)
+            k >>= std::countr_one(k) + 1;
+        }
+    }
+}
+
+FT_TEMPLATE
+const Key* FT_CLASS::lower_bound(const Key& key) const {
+    const Key* data = keys.data();
+    std::size_t k = 1;
+    while (k <= count) {
+#if defined(__GNUC__)
+        //done on the address as an integer, the line four levels down may be past the end of the array (prefetches
+        //never fault, but forming the pointer would be undefined)
+        __builtin_prefetch(reinterpret_cast<const void*>(reinterpret_cast<std::uintptr_t>(data) + k * blockSize * sizeof(Key)));
+#endif
+        k = 2 * k + static_cast<std::size_t>(compare(data[k], key));
+    }
+    //after the answer (the last node that wasn't less than key) every step went right, so strip those right turns and
+    //the left turn taken at the answer
+    k >>= std::countr_one(k) + 1;
+    return k == 0 ? nullptr : data + k;
+}
+
+FT_TEMPLATE
+bool FT_CLASS::contains(const Key& key) const {
+    const Key* found = lower_bound(key);
+    return found != nullptr && !compare(key, *found);
+}
+
+#undef FT_TEMPLATE
+#undef FT_CLASS
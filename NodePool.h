@@ -0,0 +1,269 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ * Slab (arena) allocator for tree nodes.
+ *  -Nodes are carved out of large slabs with a bump pointer, so consecutive inserts sit next to each other in memory.
+ *  -Freed nodes go onto an intrusive free list (the next pointer is stored inside the dead node) and get reused first.
+ *  -The destructor frees every slab at once, so the tree doesn't have to walk itself to clean up.
+ *  -Slabs are reference counted in groups (arenas), so when trees are joined or split and nodes move to another pool,
+ *   that pool can keep the memory alive (adopt/share) instead of copying the nodes.
+ */
+template <typename T>
+class NodePool {
+public:
+    NodePool() = default;
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    NodePool(NodePool&& other) noexcept {
+        swap(other);
+    }
+
+    NodePool& operator=(NodePool&& other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~NodePool() {
+        release();
+    }
+
+    /**
+     * @brief Constructs a new object in the pool
+     * @param args Arguments forwarded to T's constructor
+     * @return Pointer to the constructed object
+     */
+    template <typename... Args>
+    T* create(Args&&... args) {
+        Slot* slot = allocateSlot();
+        T* obj;
+        try {
+            obj = ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            pushFree(slot);
+            throw;
+        }
+        ++live;
+        return obj;
+    }
+
+    /**
+     * @brief Destroys an object and puts its slot on the free list
+     * @param obj Object previously returned by create (nullptr is ignored)
+     */
+    void destroy(T* obj) {
+        if (obj == nullptr) {
+            return;
+        }
+        obj->~T();
+        pushFree(reinterpret_cast<Slot*>(obj));
+        --live;
+    }
+
+    /**
+     * @brief Makes sure at least count more objects can be created without allocating a new slab
+     * @param count The number of extra objects to reserve room for
+     */
+    void reserve(std::size_t count) {
+        const std::size_t available = freeCount + static_cast<std::size_t>(slabEnd - cursor);
+        if (count > available) {
+            addSlab(count - available);
+        }
+    }
+
+    /**
+     * @brief Takes over everything another pool has (its memory, free slots and live objects), so objects created by
+     * either pool can be destroyed through this one. other is left empty. The bigger unused part of the two newest
+     * slabs keeps being carved, the smaller one goes on the free list
+     * @param other Pool to take over
+     */
+    void adopt(NodePool& other) {
+        if (&other == this) {
+            return;
+        }
+        keep(other.arena);
+        for (const std::shared_ptr<Arena>& borrowed : other.borrowed) {
+            keep(borrowed);
+        }
+        //splice other's free list in front of ours
+        if (other.freeList != nullptr) {
+            other.freeTail->next = freeList;
+            if (freeList == nullptr) {
+                freeTail = other.freeTail;
+            }
+            freeList = other.freeList;
+        }
+        Slot* spare = other.cursor;
+        Slot* spareEnd = other.slabEnd;
+        if (spareEnd - spare > slabEnd - cursor) {
+            std::swap(spare, cursor);
+            std::swap(spareEnd, slabEnd);
+        }
+        while (spare != spareEnd) {
+            pushFree(spare++); //at most one slab's worth (maxSlabSize)
+        }
+        live += other.live;
+        freeCount += other.freeCount;
+        slotsReserved += other.slotsReserved;
+        other.release();
+    }
+
+    /**
+     * @brief Keeps another pool's memory alive for as long as this pool holds it, so objects created by other can be
+     * handed over and destroyed through this pool. Only the total size() of the pools involved is meaningful after that
+     * (until setLive)
+     * @param other Pool whose memory to share
+     * @param slots How many of other's reserved slots to count as this pool's from now on (the ones the handed over
+     * objects sit in), so capacity() adds up to the same total across both
+     */
+    void share(NodePool& other, std::size_t slots) {
+        if (&other == this) {
+            return;
+        }
+        keep(other.arena);
+        for (const std::shared_ptr<Arena>& borrowed : other.borrowed) {
+            keep(borrowed);
+        }
+        slots = std::min(slots, other.slotsReserved);
+        other.slotsReserved -= slots;
+        slotsReserved += slots;
+    }
+
+    /**
+     * @brief Lets go of this pool's memory, slabs no other pool shares are freed (does NOT run destructors of objects
+     * that are still alive)
+     */
+    void release() noexcept {
+        arena.reset();
+        borrowed.clear();
+        freeList = nullptr;
+        freeTail = nullptr;
+        cursor = nullptr;
+        slabEnd = nullptr;
+        live = 0;
+        freeCount = 0;
+        slotsReserved = 0;
+    }
+
+    /**
+     * @brief Sets the number of live objects, for when objects moved between pools that share memory and the owner
+     * has counted what this pool holds now (a split hands every live count to one half)
+     * @param count Objects this pool is responsible for
+     */
+    void setLive(const std::size_t count) { live = count; }
+
+    std::size_t size() const { return live; } //number of live objects
+    std::size_t bytesFor(const std::size_t count) const { return count * sizeof(Slot); } //bytes count objects take up
+    std::size_t capacity() const { return slotsReserved; } //number of slots in every slab combined
+    std::size_t bytesInUse() const { return live * sizeof(Slot); }
+    std::size_t bytesReserved() const { return slotsReserved * sizeof(Slot); }
+
+    void swap(NodePool& other) noexcept {
+        std::swap(arena, other.arena);
+        std::swap(borrowed, other.borrowed);
+        std::swap(freeList, other.freeList);
+        std::swap(freeTail, other.freeTail);
+        std::swap(cursor, other.cursor);
+        std::swap(slabEnd, other.slabEnd);
+        std::swap(live, other.live);
+        std::swap(freeCount, other.freeCount);
+        std::swap(slotsReserved, other.slotsReserved);
+        std::swap(nextSlabSize, other.nextSlabSize);
+    }
+
+private:
+    //A slot either holds a live T or (when free) a pointer to the next free slot
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    //A group of slabs, freed once every pool holding a reference lets go
+    struct Arena {
+        std::vector<Slot*> slabs;
+
+        ~Arena() {
+            for (Slot* slab : slabs) {
+                delete[] slab;
+            }
+        }
+    };
+
+    static constexpr std::size_t firstSlabSize = 64;
+    static constexpr std::size_t maxSlabSize = std::size_t(1) << 16;
+
+    Slot* allocateSlot() {
+        if (freeList != nullptr) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            if (freeList == nullptr) {
+                freeTail = nullptr;
+            }
+            --freeCount;
+            return slot;
+        }
+        if (cursor == slabEnd) {
+            addSlab(nextSlabSize);
+            //grow the slabs geometrically so big trees don't end up with thousands of tiny slabs
+            if (nextSlabSize < maxSlabSize) {
+                nextSlabSize *= 2;
+            }
+        }
+        return cursor++;
+    }
+
+    void pushFree(Slot* slot) {
+        slot->next = freeList;
+        if (freeList == nullptr) {
+            freeTail = slot;
+        }
+        freeList = slot;
+        ++freeCount;
+    }
+
+    void addSlab(std::size_t count) {
+        if (arena == nullptr) {
+            arena = std::make_shared<Arena>();
+        }
+        Slot* slab = new Slot[count];
+        arena->slabs.push_back(slab);
+        //whatever was left over in the old slab goes on the free list so it isn't lost
+        while (cursor != slabEnd) {
+            pushFree(cursor++);
+        }
+        cursor = slab;
+        slabEnd = slab + count;
+        slotsReserved += count;
+    }
+
+    void keep(const std::shared_ptr<Arena>& other) {
+        if (other != nullptr && other != arena && std::find(borrowed.begin(), borrowed.end(), other) == borrowed.end()) {
+            borrowed.push_back(other);
+        }
+    }
+
+    std::shared_ptr<Arena> arena; //slabs this pool carved (created with the first slab)
+    std::vector<std::shared_ptr<Arena>> borrowed; //memory of other pools this pool may hold objects from
+    Slot* freeList = nullptr;
+    Slot* freeTail = nullptr; //so another pool's free list can be spliced on in O(1)
+    Slot* cursor = nullptr; //next unused slot in the newest slab
+    Slot* slabEnd = nullptr;
+    std::size_t live = 0;
+    std::size_t freeCount = 0;
+    std::size_t slotsReserved = 0;
+    std::size_t nextSlabSize = firstSlabSize;
+};
+
+#endif //NODEPOOL_H
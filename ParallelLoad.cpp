@@ -0,0 +1,113 @@
+#include "ParallelLoad.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iterator>
+#include <vector>
+#include "FastIntReader.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    //Splits [0, size) into about chunkCount pieces, moving every cut forward to the next whitespace so no number is cut in half
+    std::vector<std::size_t> chunkBoundaries(const InputBuffer& buffer, const std::size_t chunkCount) {
+        std::vector<std::size_t> cuts{0};
+        for (std::size_t i = 1; i < chunkCount; i++) {
+            std::size_t cut = std::max(cuts.back(), buffer.size() * i / chunkCount);
+            while (cut < buffer.size() && !isSeparator(buffer.begin()[cut])) {
+                cut++;
+            }
+            cuts.push_back(cut);
+        }
+        cuts.push_back(buffer.size());
+        return cuts;
+    }
+
+    //Merges two sorted runs, dropping duplicates
+    std::vector<int> mergeUnique(const std::vector<int>& a, const std::vector<int>& b) {
+        std::vector<int> merged;
+        merged.reserve(a.size() + b.size());
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged));
+        return merged;
+    }
+}
+
+bool parallelLoadFile(RedBlackTree& tree, const std::string& path, ThreadPool& pool, LoadTimings& timings) {
+    timings = LoadTimings();
+
+    // 1. Read (maps the file, so this is mostly just page table setup)
+    Clock::time_point start = Clock::now();
+    InputBuffer buffer;
+    if (!buffer.open(path)) {
+        return false;
+    }
+    timings.readMs = millisecondsSince(start);
+
+    // 2. Parse (a few chunks per thread so one slow chunk doesn't hold everyone up)
+    start = Clock::now();
+    const std::vector<std::size_t> cuts = chunkBoundaries(buffer, pool.size() * 4);
+    const std::size_t chunkCount = cuts.size() - 1;
+    std::vector<ScanResult> skipped(chunkCount);
+    std::vector<std::future<std::vector<int>>> parsing;
+    for (std::size_t i = 0; i < chunkCount; i++) {
+        parsing.push_back(pool.submit([&buffer, &cuts, &skipped, i] {
+            std::vector<int> numbers;
+            numbers.reserve((cuts[i + 1] - cuts[i]) / 4);
+            scanInts(buffer.begin() + cuts[i], buffer.begin() + cuts[i + 1], numbers, skipped[i]);
+            return numbers;
+        }));
+    }
+    std::vector<std::vector<int>> runs;
+    for (std::size_t i = 0; i < chunkCount; i++) {
+        runs.push_back(parsing[i].get());
+        timings.parsed += runs.back().size();
+        timings.invalid += skipped[i].invalid + skipped[i].overflow;
+    }
+    timings.parseMs = millisecondsSince(start);
+
+    // 3. Sort each run, then merge pairs of runs until one is left
+    start = Clock::now();
+    std::vector<std::future<void>> sorting;
+    for (std::vector<int>& run : runs) {
+        sorting.push_back(pool.submit([&run] {
+            std::sort(run.begin(), run.end());
+            run.erase(std::unique(run.begin(), run.end()), run.end());
+        }));
+    }
+    for (std::future<void>& done : sorting) {
+        done.get();
+    }
+
+    //keys already in the tree become one more run, so the result can be rebuilt from scratch
+    if (!tree.empty()) {
+        runs.emplace_back(tree.begin(), tree.end());
+    }
+
+    while (runs.size() > 1) {
+        std::vector<std::future<std::vector<int>>> merging;
+        for (std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+            merging.push_back(pool.submit([&runs, i] { return mergeUnique(runs[i], runs[i + 1]); }));
+        }
+        std::vector<std::vector<int>> merged;
+        for (std::future<std::vector<int>>& run : merging) {
+            merged.push_back(run.get());
+        }
+        if (runs.size() % 2 == 1) {
+            merged.push_back(std::move(runs.back())); //odd one out waits for the next round
+        }
+        runs = std::move(merged);
+    }
+    const std::vector<int> keys = runs.empty() ? std::vector<int>() : std::move(runs.front());
+    timings.duplicates = timings.parsed + tree.size() - keys.size();
+    timings.sortMs = millisecondsSince(start);
+
+    // 4. Build
+    start = Clock::now();
+    tree.assignSorted(keys.begin(), keys.end());
+    timings.buildMs = millisecondsSince(start);
+    return true;
+}
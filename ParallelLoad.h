@@ -0,0 +1,34 @@
+#ifndef PARALLELLOAD_H
+#define PARALLELLOAD_H
+
+#include <cstddef>
+#include <string>
+#include "RedBlackTree.h"
+#include "ThreadPool.h"
+
+//How long each stage of a parallel load took (in milliseconds), plus what was found in the file
+struct LoadTimings {
+    double readMs = 0;
+    double parseMs = 0;
+    double sortMs = 0;
+    double buildMs = 0;
+    std::size_t parsed = 0; //numbers read from the file
+    std::size_t duplicates = 0; //numbers skipped because they were repeated (or already in the tree)
+    std::size_t invalid = 0; //tokens that weren't integers (or didn't fit in an int)
+};
+
+/**
+ * @brief Loads every integer in a file into the tree using all the threads in the pool
+ * 1. the file is memory mapped (see InputBuffer) and split into chunks at whitespace
+ * 2. each chunk is parsed on its own thread
+ * 3. each chunk is sorted and deduplicated on its own thread, then the chunks are merged in pairs (in parallel) until one is left
+ * 4. the tree is built from the sorted keys in one pass (keys already in the tree are merged in first)
+ * @param tree The tree to load into
+ * @param path Path of the file ("-" for stdin)
+ * @param pool Threads to do the work on
+ * @param timings Filled in with how long each stage took
+ * @return false if the file couldn't be opened
+ */
+bool parallelLoadFile(RedBlackTree& tree, const std::string& path, ThreadPool& pool, LoadTimings& timings);
+
+#endif //PARALLELLOAD_H
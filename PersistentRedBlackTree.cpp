@@ -0,0 +1,4 @@
+#include "PersistentRedBlackTree.h"
+
+//Compile the int version once here
+template class BasicPersistentRedBlackTree<int>;
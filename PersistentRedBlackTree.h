@@ -0,0 +1,128 @@
+#ifndef PERSISTENTREDBLACKTREE_H
+#define PERSISTENTREDBLACKTREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "RedBlackTree.h"
+
+/*
+ * Persistent (path copying) Red-Black tree.
+ *  -Nodes are immutable and reference counted. An insert or remove copies only the O(log n) nodes on the path it
+ *   changes and shares every other node with the previous version.
+ *  -snapshot() is O(1): it just takes another reference to the current root. A snapshot never changes, stays valid
+ *   while the live tree keeps changing, and can be read from any thread without locks.
+ *  -Nodes are freed as soon as no version uses them any more.
+ * Insert and remove use Kahrs' functional balancing (Red-Black trees with types, 2001) instead of rotations, since
+ * nodes can't be changed in place. Writers are serialized with a mutex.
+ */
+template <typename Key, typename Compare = std::less<Key>>
+class BasicPersistentRedBlackTree {
+public:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        Key data; //key stored in node
+        Color color;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    //One version of the tree
+    struct State {
+        NodePtr root;
+        std::size_t size = 0;
+    };
+
+    //Read only view of the tree at the moment snapshot() was called
+    class Snapshot {
+    public:
+        Snapshot() = default;
+
+        /**
+         * @brief Checks if a key was in the tree
+         */
+        bool contains(const Key& key) const;
+
+        /**
+         * @brief Calls fn(key) on every key in order (uses an explicit stack, no recursion)
+         */
+        template <typename F>
+        void for_each(F&& fn) const;
+
+        /**
+         * @brief Checks every Red-Black property
+         * @return true if the version is a valid Red-Black tree
+         */
+        bool isValid() const;
+
+        std::size_t size() const { return state ? state->size : 0; }
+        bool empty() const { return size() == 0; }
+        const Node* root() const { return state ? state->root.get() : nullptr; }
+
+    private:
+        friend class BasicPersistentRedBlackTree;
+
+        Snapshot(std::shared_ptr<const State> state, const Compare& compare) : state(std::move(state)), compare(compare) {
+        }
+
+        std::shared_ptr<const State> state;
+        [[no_unique_address]] Compare compare; //the tree's comparator (a copy, so the snapshot doesn't need the tree)
+    };
+
+    BasicPersistentRedBlackTree();
+    explicit BasicPersistentRedBlackTree(const Compare& compare);
+
+    /**
+     * @brief Inserts a key (copies the search path)
+     * @return true if it was inserted, false if it was already there (nothing is copied then)
+     */
+    bool insert(const Key& key);
+
+    /**
+     * @brief Removes a key (copies the search path)
+     * @return true if it was removed, false if it wasn't there (nothing is copied then)
+     */
+    bool remove(const Key& key);
+
+    /**
+     * @brief Checks if a key is in the current version
+     */
+    bool contains(const Key& key) const { return snapshot().contains(key); }
+
+    /**
+     * @brief Takes an O(1) read only snapshot of the current version
+     */
+    Snapshot snapshot() const { return Snapshot(current.load(std::memory_order_acquire), compare); }
+
+    std::size_t size() const { return snapshot().size(); }
+
+private:
+    static bool isRed(const NodePtr& node) { return node != nullptr && node->color == RED; }
+    static bool isBlack(const NodePtr& node) { return node != nullptr && node->color == BLACK; } //null doesn't count here
+
+    static NodePtr make(Color color, NodePtr left, const Key& data, NodePtr right);
+    static NodePtr blacken(const NodePtr& node);
+    static NodePtr redden(const NodePtr& node);
+    static NodePtr balance(const NodePtr& left, const Key& data, const NodePtr& right);
+    static NodePtr balanceLeft(const NodePtr& left, const Key& data, const NodePtr& right);
+    static NodePtr balanceRight(const NodePtr& left, const Key& data, const NodePtr& right);
+    static NodePtr append(const NodePtr& left, const NodePtr& right);
+
+    NodePtr insertInto(const NodePtr& node, const Key& key) const;
+    NodePtr removeFrom(const NodePtr& node, const Key& key) const;
+
+    std::atomic<std::shared_ptr<const State>> current;
+    std::mutex writerLock;
+    [[no_unique_address]] Compare compare;
+};
+
+#include "PersistentRedBlackTree.tpp"
+
+extern template class BasicPersistentRedBlackTree<int>;
+using PersistentRedBlackTree = BasicPersistentRedBlackTree<int>;
+
+#endif //PERSISTENTREDBLACKTREE_H
@@ -0,0 +1,254 @@
+//Definitions for BasicPersistentRedBlackTree (included at the bottom of PersistentRedBlackTree.h, don't include this directly)
+#include <stdexcept>
+#include <vector>
+
+#define PRBT_TEMPLATE template <typename Key, typename Compare>
+#define PRBT_CLASS BasicPersistentRedBlackTree<Key, Compare>
+
+PRBT_TEMPLATE
+PRBT_CLASS::BasicPersistentRedBlackTree() : current(std::make_shared<const State>()) {
+}
+
+PRBT_TEMPLATE
+PRBT_CLASS::BasicPersistentRedBlackTree(const Compare& compare) : current(std::make_shared<const State>()), compare(compare) {
+}
+
+PRBT_TEMPLATE
+auto PRBT_CLASS::make(const Color color, NodePtr left, const Key& data, NodePtr right) -> NodePtr {
+    return std::make_shared<const Node>(Node{data, color, std::move(left), std::move(right)});
+}
+
+PRBT_TEMPLATE
+auto PRBT_CLASS::blacken(const NodePtr& node) -> NodePtr {
+    if (isRed(node)) {
+        return make(BLACK, node->left, node->data, node->right);
+    }
+    return node;
+}
+
+PRBT_TEMPLATE
+auto PRBT_CLASS::redden(const NodePtr& node) -> NodePtr {
+    return make(RED, node->left, node->data, node->right);
+}
+
+/*
+ * Builds a black node out of (left, data, right), fixing a red-red violation in either child by turning it into a red
+ * node with two black children. This is the functional version of insertBalance cases 2, 5 and 6.
+ */
+PRBT_TEMPLATE
+auto PRBT_CLASS::balance(const NodePtr& left, const Key& data, const NodePtr& right) -> NodePtr {
+    if (isRed(left) && isRed(right)) {
+        return make(RED, blacken(left), data, blacken(right));
+    }
+    if (isRed(left)) {
+        if (isRed(left->left)) {
+            return make(RED, blacken(left->left), left->data, make(BLACK, left->right, data, right));
+        }
+        if (isRed(left->right)) {
+            return make(RED, make(BLACK, left->left, left->data, left->right->left), left->right->data,
+                        make(BLACK, left->right->right, data, right));
+        }
+    }
+    if (isRed(right)) {
+        if (isRed(right->right)) {
+            return make(RED, make(BLACK, left, data, right->left), right->data, blacken(right->right));
+        }
+        if (isRed(right->left)) {
+            return make(RED, make(BLACK, left, data, right->left->left), right->left->data,
+                        make(BLACK, right->left->right, right->data, right->right));
+        }
+    }
+    return make(BLACK, left, data, right);
+}
+
+//left is one black node short after a remove
+PRBT_TEMPLATE
+auto PRBT_CLASS::balanceLeft(const NodePtr& left, const Key& data, const NodePtr& right) -> NodePtr {
+    if (isRed(left)) {
+        return make(RED, blacken(left), data, right);
+    }
+    if (isBlack(right)) {
+        return balance(left, data, redden(right));
+    }
+    if (isRed(right) && isBlack(right->left)) {
+        return make(RED, make(BLACK, left, data, right->left->left), right->left->data,
+                    balance(right->left->right, right->data, redden(right->right)));
+    }
+    throw std::logic_error("PersistentRedBlackTree: invalid tree in balanceLeft");
+}
+
+//Mirror of balanceLeft, right is one black node short
+PRBT_TEMPLATE
+auto PRBT_CLASS::balanceRight(const NodePtr& left, const Key& data, const NodePtr& right) -> NodePtr {
+    if (isRed(right)) {
+        return make(RED, left, data, blacken(right));
+    }
+    if (isBlack(left)) {
+        return balance(redden(left), data, right);
+    }
+    if (isRed(left) && isBlack(left->right)) {
+        return make(RED, balance(redden(left->left), left->data, left->right->left), left->right->data,
+                    make(BLACK, left->right->right, data, right));
+    }
+    throw std::logic_error("PersistentRedBlackTree: invalid tree in balanceRight");
+}
+
+//Joins the two subtrees of a removed node (every key in left is less than every key in right)
+PRBT_TEMPLATE
+auto PRBT_CLASS::append(const NodePtr& left, const NodePtr& right) -> NodePtr {
+    if (left == nullptr) {
+        return right;
+    }
+    if (right == nullptr) {
+        return left;
+    }
+    if (isRed(left) && isRed(right)) {
+        const NodePtr middle = append(left->right, right->left);
+        if (isRed(middle)) {
+            return make(RED, make(RED, left->left, left->data, middle->left), middle->data,
+                        make(RED, middle->right, right->data, right->right));
+        }
+        return make(RED, left->left, left->data, make(RED, middle, right->data, right->right));
+    }
+    if (isBlack(left) && isBlack(right)) {
+        const NodePtr middle = append(left->right, right->left);
+        if (isRed(middle)) {
+            return make(RED, make(BLACK, left->left, left->data, middle->left), middle->data,
+                        make(BLACK, middle->right, right->data, right->right));
+        }
+        return balanceLeft(left->left, left->data, make(BLACK, middle, right->data, right->right));
+    }
+    if (isRed(right)) {
+        return make(RED, append(left, right->left), right->data, right->right);
+    }
+    return make(RED, left->left, left->data, append(left->right, right));
+}
+
+//Returns the same node if the key was already there, so nothing above it gets copied
+PRBT_TEMPLATE
+auto PRBT_CLASS::insertInto(const NodePtr& node, const Key& key) const -> NodePtr {
+    if (node == nullptr) {
+        return make(RED, nullptr, key, nullptr);
+    }
+    if (compare(key, node->data)) {
+        const NodePtr newLeft = insertInto(node->left, key);
+        if (newLeft == node->left) {
+            return node;
+        }
+        return node->color == BLACK ? balance(newLeft, node->data, node->right)
+                                    : make(RED, newLeft, node->data, node->right);
+    }
+    if (compare(node->data, key)) {
+        const NodePtr newRight = insertInto(node->right, key);
+        if (newRight == node->right) {
+            return node;
+        }
+        return node->color == BLACK ? balance(node->left, node->data, newRight)
+                                    : make(RED, node->left, node->data, newRight);
+    }
+    return node;
+}
+
+//The key must be in the tree (remove checks first), so every node on the path gets copied exactly once
+PRBT_TEMPLATE
+auto PRBT_CLASS::removeFrom(const NodePtr& node, const Key& key) const -> NodePtr {
+    if (compare(key, node->data)) {
+        if (isBlack(node->left)) {
+            return balanceLeft(removeFrom(node->left, key), node->data, node->right);
+        }
+        return make(RED, removeFrom(node->left, key), node->data, node->right);
+    }
+    if (compare(node->data, key)) {
+        if (isBlack(node->right)) {
+            return balanceRight(node->left, node->data, removeFrom(node->right, key));
+        }
+        return make(RED, node->left, node->data, removeFrom(node->right, key));
+    }
+    return append(node->left, node->right);
+}
+
+PRBT_TEMPLATE
+bool PRBT_CLASS::insert(const Key& key) {
+    std::lock_guard<std::mutex> lock(writerLock);
+    const std::shared_ptr<const State> state = current.load(std::memory_order_acquire);
+    const NodePtr newRoot = insertInto(state->root, key);
+    if (newRoot == state->root) {
+        return false;
+    }
+    current.store(std::make_shared<const State>(State{blacken(newRoot), state->size + 1}), std::memory_order_release);
+    return true;
+}
+
+PRBT_TEMPLATE
+bool PRBT_CLASS::remove(const Key& key) {
+    std::lock_guard<std::mutex> lock(writerLock);
+    const std::shared_ptr<const State> state = current.load(std::memory_order_acquire);
+    if (!Snapshot(state, compare).contains(key)) {
+        return false;
+    }
+    current.store(std::make_shared<const State>(State{blacken(removeFrom(state->root, key)), state->size - 1}),
+                  std::memory_order_release);
+    return true;
+}
+
+PRBT_TEMPLATE
+bool PRBT_CLASS::Snapshot::contains(const Key& key) const {
+    const Node* pos = root();
+    while (pos != nullptr) {
+        if (compare(key, pos->data)) {
+            pos = pos->left.get();
+        } else if (compare(pos->data, key)) {
+            pos = pos->right.get();
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+PRBT_TEMPLATE
+template <typename F>
+void PRBT_CLASS::Snapshot::for_each(F&& fn) const {
+    std::vector<const Node*> stack; //never deeper than 2 log n
+    const Node* pos = root();
+    while (pos != nullptr || !stack.empty()) {
+        while (pos != nullptr) {
+            stack.push_back(pos);
+            pos = pos->left.get();
+        }
+        pos = stack.back();
+        stack.pop_back();
+        fn(pos->data);
+        pos = pos->right.get();
+    }
+}
+
+PRBT_TEMPLATE
+bool PRBT_CLASS::Snapshot::isValid() const {
+    bool valid = !isRed(state ? state->root : nullptr);
+    //returns the black height of the subtree, checking order, red-red and black heights on the way
+    const auto check = [&](const auto& self, const Node* node) -> int {
+        if (node == nullptr) {
+            return 1;
+        }
+        for (const Node* child : {node->left.get(), node->right.get()}) {
+            if (child != nullptr && node->color == RED && child->color == RED) {
+                valid = false;
+            }
+        }
+        if ((node->left && !compare(node->left->data, node->data)) || (node->right && !compare(node->data, node->right->data))) {
+            valid = false;
+        }
+        const int leftHeight = self(self, node->left.get());
+        const int rightHeight = self(self, node->right.get());
+        if (leftHeight != rightHeight) {
+            valid = false;
+        }
+        return leftHeight + (node->color == BLACK ? 1 : 0);
+    };
+    check(check, root());
+    return valid;
+}
+
+#undef PRBT_TEMPLATE
+#undef PRBT_CLASS
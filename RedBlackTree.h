@@ -1,6 +1,25 @@
 #ifndef REDBLACKTREE_H
 #define REDBLACKTREE_H
 
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "FrozenTree.h"
+#include "NodePool.h"
+#include "ThreadPool.h"
+#include "TreeExport.h"
+#include "TreeStats.h"
+#include "TreeValidation.h"
 
 enum Color {
     RED,
@@ -14,19 +33,142 @@ enum direction {
 };
 
 
-struct Node {
-    int data{}; //data stored in node
-    Node* left = nullptr; //left will be index 0
-    Node* right = nullptr; //right will be index 1
-    Node* parent = nullptr; //node's parent
+//Mapped type used when the tree is just a set of keys (takes up no space in the node)
+struct EmptyValue {};
+
+//Mapped type that makes the tree a multiset: a repeated key adds to its node's count instead of being rejected
+struct KeyCount {
+    std::uint32_t count = 1; //copies of the key (32 bits, so an int node stays the size of a set's)
+};
+
+//What insert_batch or erase_batch did with a batch of keys
+struct BatchResult {
+    std::size_t applied = 0; //keys inserted (or erased)
+    std::size_t skipped = 0; //keys already in the tree or repeated in the batch (for erase: keys that weren't there)
+};
+
+
+/*
+ * Augmentations keep extra data in every node that depends on the node's subtree.
+ * Each one has a Data struct (stored in the node as aug) and an update(node) that recomputes a node's Data from its
+ * children. The tree calls update on every node whose subtree changes (rotations, and the path above an insert or remove).
+ */
+
+//No augmentation (takes up no space, and every update compiles away)
+struct NoAugment {
+    struct Data {};
+
+    template <typename N>
+    static void update(N*) {
+    }
+};
+
+//Counts the nodes in every subtree, which gives O(log n) rank/select (order statistics)
+struct SubtreeSize {
+    struct Data {
+        std::size_t size = 1; //nodes start as a leaf
+    };
+
+    template <typename N>
+    static std::size_t sizeOf(const N* node) {
+        return node == nullptr ? 0 : node->aug.size;
+    }
+
+    template <typename N>
+    static void update(N* node) {
+        node->aug.size = 1 + sizeOf(node->left) + sizeOf(node->right);
+    }
+};
+
+//Augmentations that count subtree sizes (these enable rank, select and count_range)
+template <typename Augment>
+concept OrderStatisticAugment = requires(typename Augment::Data data) {
+    { data.size } -> std::convertible_to<std::size_t>;
+};
+
+//Closed interval [start, end], ordered by start (then end, so intervals that start at the same point can share a tree)
+template <typename T>
+struct Interval {
+    T start;
+    T end;
+
+    bool overlaps(const T& lo, const T& hi) const { return !(end < lo) && !(hi < start); }
+
+    friend bool operator<(const Interval& a, const Interval& b) {
+        return a.start < b.start || (!(b.start < a.start) && a.end < b.end);
+    }
+
+    friend bool operator==(const Interval& a, const Interval& b) {
+        return !(a < b) && !(b < a);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const Interval& interval) {
+        return out << '[' << interval.start << ", " << interval.end << ']';
+    }
+};
+
+//Keeps the largest end point of every subtree of Interval<T> keys, so overlap queries can skip subtrees that end too early
+template <typename T>
+struct MaxEnd {
+    using Point = T;
+
+    struct Data {
+        T maxEnd{}; //set from the node's own interval once it's linked in
+    };
+
+    template <typename N>
+    static const T& subtreeMaxEnd(const N* node) {
+        const T* largest = &node->data.end;
+        for (const N* child : {node->left, node->right}) {
+            if (child != nullptr && *largest < child->aug.maxEnd) {
+                largest = &child->aug.maxEnd;
+            }
+        }
+        return *largest;
+    }
+
+    template <typename N>
+    static void update(N* node) {
+        node->aug.maxEnd = subtreeMaxEnd(node);
+    }
+};
+
+//Augmentations that track the largest end point under each node (these enable overlapping and stabbing)
+template <typename Augment>
+concept IntervalAugment = requires(typename Augment::Data data) {
+    typename Augment::Point;
+    data.maxEnd;
+};
+
+//End point type of an interval augmentation (EmptyValue for the others, which don't have overlap queries)
+template <typename Augment>
+struct IntervalPointOf {
+    using type = EmptyValue;
+};
+
+template <IntervalAugment Augment>
+struct IntervalPointOf<Augment> {
+    using type = typename Augment::Point;
+};
+
+
+template <typename Key, typename Value = EmptyValue, typename Augment = NoAugment>
+struct BasicNode {
+    Key data; //key stored in node
+    [[no_unique_address]] Value value; //mapped value (EmptyValue for plain sets)
+    [[no_unique_address]] typename Augment::Data aug; //augmented subtree data (nothing for NoAugment)
+    BasicNode* left = nullptr; //left will be index 0
+    BasicNode* right = nullptr; //right will be index 1
+    BasicNode* parent = nullptr; //node's parent
     Color color = RED; //nodes start as the color red
 
     /**
-    * @brief Constructs a node with the given value
-    * @param data Value to store in the node
+    * @brief Constructs a node with the given key, building the mapped value in place
+    * @param data Key to store in the node
+    * @param args Arguments forwarded to the mapped value's constructor
     */
-    explicit Node(const int data) {
-        this->data = data;
+    template <typename K, typename... Args>
+    explicit BasicNode(K&& data, Args&&... args) : data(std::forward<K>(data)), value(std::forward<Args>(args)...) {
     }
 
     /**
@@ -34,7 +176,7 @@ struct Node {
  * @param index The index of the child to retrieve
  * @return Pointer to the child node
  */
-    Node* child(const int index) const {
+    BasicNode* child(const int index) const {
         return index == 0 ? left : right;
     }
 
@@ -43,7 +185,7 @@ struct Node {
     * @param index The index of the child to set
     * @param node The node to set as the child
     */
-    void setChild(const int index, Node* node) {
+    void setChild(const int index, BasicNode* node) {
         if (index == 0) {
             left = node;
         } else {
@@ -53,12 +195,108 @@ struct Node {
 };
 
 
-class RedBlackTree {
+using Node = BasicNode<int>;
+
+
+/*
+ * Red-Black tree over Key (with an optional mapped Value).
+ *  -Compare is a strict weak ordering on Key (it's stored in the tree, so stateless comparators get inlined).
+ *  -Allocator is a node allocator template like NodePool: it needs create(args...), destroy(node), reserve(count), bytesInUse() and bytesReserved()
+ *   (and adopt, share, setLive, bytesFor and capacity for join and split).
+ *  -Augment keeps subtree data in every node (see NoAugment, SubtreeSize and MaxEnd).
+ */
+template <typename Key, typename Value = EmptyValue, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodePool, typename Augment = NoAugment>
+class BasicRedBlackTree {
 public:
-    RedBlackTree();
+    using key_type = Key;
+    using mapped_type = Value;
+    using key_compare = Compare;
+    using Node = BasicNode<Key, Value, Augment>;
+    using point_type = typename IntervalPointOf<Augment>::type; //interval end points (interval trees only)
+
+    //KeyCount trees keep repeated keys as a count in one node (see count and total_count)
+    static constexpr bool multiset = std::is_same_v<Value, KeyCount>;
+
+    /*
+     * In order iterator. Steps through the parent pointers, so it never allocates.
+     * end() is a null node (decrementing it goes to the largest key).
+     */
+    class iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Key*;
+        using reference = const Key&;
+
+        iterator() = default;
+
+        reference operator*() const { return current->data; }
+        pointer operator->() const { return &current->data; }
+
+        /**
+         * @brief Gets the node the iterator is on (use this to get to the mapped value)
+         * @return The current node, nullptr for end()
+         */
+        Node* node() const { return current; }
+
+        iterator& operator++() {
+            current = current == tree->last ? nullptr : successor(current);
+            return *this;
+        }
 
-    // Existing methods...
-    void checkTree(); // Public method to validate tree properties
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        iterator& operator--() {
+            current = current == nullptr ? tree->last : predecessor(current);
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const { return current == other.current; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+
+    private:
+        friend class BasicRedBlackTree;
+
+        iterator(Node* current, const BasicRedBlackTree* tree) : current(current), tree(tree) {
+        }
+
+        Node* current = nullptr;
+        const BasicRedBlackTree* tree = nullptr;
+    };
+
+    BasicRedBlackTree();
+    explicit BasicRedBlackTree(const Compare& compare);
+
+    BasicRedBlackTree(const BasicRedBlackTree&) = delete;
+    BasicRedBlackTree& operator=(const BasicRedBlackTree&) = delete;
+    BasicRedBlackTree(BasicRedBlackTree&& other) noexcept;
+    BasicRedBlackTree& operator=(BasicRedBlackTree&& other) noexcept;
+
+    /**
+     * @brief Validates the tree and prints the result (the black height, or the first thing wrong with it)
+     * @return true if the tree is valid
+     */
+    bool checkTree() const;
+
+    /**
+     * @brief Checks every red-black tree property without recursion: key order, parent links, red-red, black heights,
+     * subtree sizes (with SubtreeSize), size() and the cached ends. Stops at the first violation
+     * @param pool If given (and the tree is big enough to be worth it), subtrees are checked on its threads
+     * @return The first violation found (if any), the number of nodes, the maximum depth and the black height
+     */
+    ValidationReport<Node> validate(ThreadPool* pool = nullptr) const;
 
     /**
  * @brief Rotates a subtree around a pivot node in the specified direction
@@ -96,6 +334,156 @@ public:
  */
     static Node* tree_min(Node* node);
 
+    /**
+ * @brief Finds the maximum value node in a subtree
+ * @param node The root of the subtree
+ * @return Pointer to the node with maximum value
+ */
+    static Node* tree_max(Node* node);
+
+    /**
+ * @brief Finds the next node in order
+ * @param node The node to start from
+ * @return The in order successor, nullptr if node is the largest
+ */
+    static Node* successor(Node* node);
+
+    /**
+ * @brief Finds the previous node in order
+ * @param node The node to start from
+ * @return The in order predecessor, nullptr if node is the smallest
+ */
+    static Node* predecessor(Node* node);
+
+    iterator begin() const { return iterator(first, this); } //smallest key
+    iterator end() const { return iterator(nullptr, this); } //one past the largest key
+
+    /**
+ * @brief Finds a key
+ * @param key The key to search for
+ * @return Iterator to the key, end() if it's not in the tree
+ */
+    iterator find(const Key& key) const;
+
+    /**
+ * @brief Finds a batch of keys at once. Up to batchWindow lookups are in flight: each round moves every one of them
+ * down a level and prefetches the child it moved to, so the cache misses of different keys overlap instead of each
+ * level waiting on memory. A finished lookup's slot goes straight to the next key
+ * @param keys Keys to search for, in any order
+ * @param results Filled with an iterator per key (end() if it's not in the tree), must be at least as long as keys
+ * @throws std::invalid_argument if results is shorter than keys
+ */
+    void find_batch(std::span<const Key> keys, std::span<iterator> results) const;
+
+    /**
+ * @brief Checks a batch of keys at once, the same way as find_batch
+ * @param keys Keys to search for, in any order
+ * @param results Filled with whether each key is in the tree, must be at least as long as keys
+ * @return Number of keys that were found
+ * @throws std::invalid_argument if results is shorter than keys
+ */
+    std::size_t contains_batch(std::span<const Key> keys, std::span<bool> results) const;
+
+    /**
+ * @brief Finds the first key that is not less than key
+ * @return Iterator to that key, end() if every key is less
+ */
+    iterator lower_bound(const Key& key) const;
+
+    /**
+ * @brief Finds the first key that is greater than key
+ * @return Iterator to that key, end() if no key is greater
+ */
+    iterator upper_bound(const Key& key) const;
+
+    /**
+ * @brief Finds the largest key that is not greater than key
+ * @return Iterator to that key, end() if every key is greater
+ */
+    iterator floor(const Key& key) const;
+
+    /**
+ * @brief Finds the smallest key that is not less than key (same as lower_bound)
+ * @return Iterator to that key, end() if every key is less
+ */
+    iterator ceil(const Key& key) const { return lower_bound(key); }
+
+    /**
+ * @brief Calls fn on every node with a key in [lo, hi], in order. One descent to find lo, then it steps through the
+ * parent pointers (no recursion, no allocation)
+ * @param lo Smallest key to visit
+ * @param hi Largest key to visit
+ * @param fn Called with each node (Node&), so mapped values can be read or changed
+ */
+    template <typename F>
+    void for_each_in_range(const Key& lo, const Key& hi, F&& fn) const;
+
+    /**
+ * @brief Copies the keys into a read only Eytzinger layout that answers contains/lower_bound without chasing pointers
+ * (see BasicFrozenTree). O(n); to rebuild an existing snapshot without allocating, call its assign(begin(), size())
+ * @return The frozen snapshot (later writes to the tree don't show up in it)
+ */
+    BasicFrozenTree<Key, Compare> freeze() const;
+
+    std::size_t size() const; //number of keys in the tree (counted again after a split without SubtreeSize)
+    bool empty() const { return root == nullptr; }
+
+    /**
+ * @brief Counts the copies of a key in O(log n)
+ * @return 0 or 1, or the key's count in a multiset
+ */
+    std::size_t count(const Key& key) const;
+
+    /**
+ * @brief Counts the keys with all their copies (the same as size() unless the tree is a multiset). O(1), except after
+ * a split or erase_range of a multiset, which adds the counts up again once
+ */
+    std::size_t total_count() const;
+
+    /**
+ * @brief Counts the keys less than key in O(log n) (needs an order statistic augmentation)
+ * @param key The key to rank (doesn't have to be in the tree)
+ * @return Number of keys in the tree that are less than key
+ */
+    std::size_t rank(const Key& key) const requires OrderStatisticAugment<Augment>;
+
+    /**
+ * @brief Finds the k-th smallest key in O(log n) (needs an order statistic augmentation)
+ * @param k Zero based position in sorted order
+ * @return Iterator to the key, end() if k >= size()
+ */
+    iterator select(std::size_t k) const requires OrderStatisticAugment<Augment>;
+
+    /**
+ * @brief Counts the keys in [lo, hi] in O(log n) (needs an order statistic augmentation)
+ * @param lo Smallest key to count
+ * @param hi Largest key to count
+ * @return Number of keys between lo and hi (inclusive), 0 if hi < lo
+ */
+    std::size_t count_range(const Key& lo, const Key& hi) const requires OrderStatisticAugment<Augment>;
+
+    /**
+ * @brief Visits every interval that overlaps [lo, hi] in key order (needs an interval augmentation). Subtrees whose
+ * largest end is below lo, and right subtrees starting after hi, are skipped, so it costs O(log n) plus the paths down
+ * to the k results (O(log n + k) when they're close together, never more than O(k log n)). Nothing is allocated
+ * @param lo Start of the query range
+ * @param hi End of the query range (nothing overlaps if hi < lo)
+ * @param visit Called with each overlapping interval (const Key&). If it returns bool, false stops the query
+ * @return Number of intervals visited
+ */
+    template <typename F>
+    std::size_t overlapping(const point_type& lo, const point_type& hi, F&& visit) const
+        requires IntervalAugment<Augment>;
+
+    /**
+ * @brief Visits every interval that contains the point x (a stabbing query, the same as overlapping(x, x, visit))
+ * @return Number of intervals visited
+ */
+    template <typename F>
+    std::size_t stabbing(const point_type& x, F&& visit) const requires IntervalAugment<Augment> {
+        return overlapping(x, x, std::forward<F>(visit));
+    }
+
     /**
  * @brief Inserts a new value into the Red-Black tree
  * @param pos Reference to the current position in the tree (initially root)
@@ -103,7 +491,128 @@ public:
  * @param data Value to be inserted
  * @param dir Direction from parent (defaults to right)
  */
-    void insert(Node* & pos, Node* prev, int data, direction dir = right);
+    void insert(Node* & pos, Node* prev, const Key& data, direction dir = right);
+
+    /**
+ * @brief Inserts a key, constructing its mapped value in place (nothing is built if the key is already there, a
+ * multiset adds one to the key's count instead, without allocating or rebalancing)
+ * @param key Key to insert
+ * @param args Arguments forwarded to the mapped value's constructor
+ * @return The node holding the key, and whether it was newly inserted
+ * @throws std::overflow_error if a multiset key already has the most copies a count can hold
+ */
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace(K&& key, Args&&... args);
+
+    /**
+ * @brief Inserts a key without recursion
+ * @param key Key to insert
+ * @return Iterator to the key, and whether it was newly inserted
+ */
+    std::pair<iterator, bool> insert(const Key& key) { return emplace(key); }
+
+    /**
+ * @brief Inserts a key next to a hint. Costs amortized O(1) if the key belongs right before or right after the hint
+ * (so feeding it sorted keys with the last result as the hint never walks down from the root)
+ * @param hint Position the key is expected to go next to (end() is fine for appending)
+ * @param key Key to insert
+ * @return Iterator to the key (the existing one if it was already in the tree)
+ */
+    iterator insert(iterator hint, const Key& key) { return emplace_hint(hint, key); }
+
+    /**
+ * @brief Hinted version of emplace, see insert(hint, key)
+ * @param hint Position the key is expected to go next to
+ * @param key Key to insert
+ * @param args Arguments forwarded to the mapped value's constructor
+ * @return Iterator to the key
+ */
+    template <typename K, typename... Args>
+    iterator emplace_hint(iterator hint, K&& key, Args&&... args);
+
+    /**
+ * @brief Replaces the contents of the tree with a sorted range in O(n), without any rotations or recoloring passes
+ * @param begin Start of the keys (must be sorted by the tree's comparator, with no duplicates)
+ * @param end End of the keys
+ */
+    template <typename RandomIt>
+    void assignSorted(RandomIt begin, RandomIt end);
+
+    /**
+ * @brief Inserts a batch of keys. The batch is sorted and deduplicated first, then applied in key order: each key is
+ * found by climbing up from the previous one instead of descending from the root. A batch that is big compared to the
+ * tree is merged with the tree's keys and rebuilt in O(n + m) instead (key only trees, invalidates iterators).
+ * A multiset inserts every key in the batch one by one, repeats included
+ * @param keys Keys to insert, in any order
+ * @return How many keys were inserted and how many were duplicates
+ */
+    BatchResult insert_batch(std::span<const Key> keys);
+
+    /**
+ * @brief Removes a batch of keys, the same way insert_batch adds them (a multiset removes one copy per key)
+ * @param keys Keys to remove, in any order
+ * @return How many keys were removed and how many weren't in the tree
+ */
+    BatchResult erase_batch(std::span<const Key> keys);
+
+    /**
+ * @brief Joins two trees and a key between them into one tree in O(log n): the key's node goes down the taller tree's
+ * inner edge to the first black subtree as tall (in black nodes) as the shorter tree, then insertBalance fixes it up
+ * @param left Tree whose keys are all less than key (emptied, its nodes move over without copying)
+ * @param key Key that goes between the two trees
+ * @param right Tree whose keys are all greater than key (emptied)
+ * @return The joined tree
+ * @throws std::invalid_argument if the keys aren't in order
+ */
+    static BasicRedBlackTree join(BasicRedBlackTree&& left, const Key& key, BasicRedBlackTree&& right);
+
+    /**
+ * @brief Joins two trees without a key between them in O(log n) (the largest node of left is used as the join key)
+ * @param left Tree whose keys are all less than right's (emptied)
+ * @param right Tree whose keys are all greater than left's (emptied)
+ * @return The joined tree
+ * @throws std::invalid_argument if the keys aren't in order
+ */
+    static BasicRedBlackTree join2(BasicRedBlackTree&& left, BasicRedBlackTree&& right);
+
+    /**
+ * @brief Cuts the tree at a key in O(log n) by taking apart the search path and joining the pieces back up on each
+ * side. This tree ends up empty, its nodes move to the two halves without copying
+ * @param key Key to split at
+ * @return (keys less than key, key's mapped value if it was in the tree, keys greater than key)
+ */
+    std::tuple<BasicRedBlackTree, std::optional<Value>, BasicRedBlackTree> split(const Key& key);
+
+    /**
+ * @brief Keys in either tree. Divide and conquer: b is split at a's root key, the two halves on each side are united
+ * (big ones in parallel on pool) and joined back with a's root. O(m log(n / m + 1)) work for trees of size m <= n
+ * @param a First tree (emptied, for a key in both trees the mapped value comes from a)
+ * @param b Second tree (emptied)
+ * @param pool Runs independent subtrees at the same time (nullptr runs everything on the calling thread)
+ * @return Tree with every key from a and b
+ */
+    static BasicRedBlackTree set_union(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool = nullptr)
+        requires (!multiset);
+
+    /**
+ * @brief Keys in both trees, the same way as set_union (a's root is only joined back if b had its key)
+ * @param a First tree (emptied, mapped values come from a)
+ * @param b Second tree (emptied)
+ * @param pool Runs independent subtrees at the same time (nullptr runs everything on the calling thread)
+ * @return Tree with the keys that are in a and b
+ */
+    static BasicRedBlackTree set_intersection(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool = nullptr)
+        requires (!multiset);
+
+    /**
+ * @brief Keys in a that aren't in b. Here a is split at b's root key, and the halves are joined back without it
+ * @param a Tree to take keys from (emptied)
+ * @param b Keys to leave out (emptied)
+ * @param pool Runs independent subtrees at the same time (nullptr runs everything on the calling thread)
+ * @return Tree with the keys that are in a but not in b
+ */
+    static BasicRedBlackTree set_difference(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool = nullptr)
+        requires (!multiset);
 
     /**
  * @brief Rebalances the tree after insertion to maintain Red-Black properties
@@ -113,19 +622,37 @@ public:
     void insertBalance(Node* node, direction dir);
 
     /**
- * @brief Removes a node from the Red-Black tree
+ * @brief Removes a node from the Red-Black tree (in a multiset, takes one off its count and only removes the node
+ * once the count reaches zero)
  * @param toRemove The node to be removed
  */
     void remove(Node *toRemove);
 
+    /**
+ * @brief Removes a key, finding its node and unlinking it in the same pass (one copy of it in a multiset)
+ * @param key The key to remove
+ * @return true if the key was in the tree
+ */
+    bool erase(const Key& key);
+
+    /**
+ * @brief Removes every key in [lo, hi] (with all its copies) in O(log n + k): the tree is split at lo and hi, the middle part is freed and
+ * the outer parts are joined again (invalidates iterators)
+ * @param lo Smallest key to remove
+ * @param hi Largest key to remove
+ * @return Number of keys removed (0 if hi < lo)
+ */
+    std::size_t erase_range(const Key& lo, const Key& hi);
+
     /**
  * @brief Rebalances the tree after removal to maintain Red-Black properties
- * @param node The node that was removed
+ * @param parent Parent of the subtree that lost a black node
+ * @param dir Side of parent the short subtree is on
  */
-    void removeBalance(const Node* node);
+    void removeBalance(Node* parent, direction dir);
 
     /**
- * @brief Prints the tree structure with indentation based on depth
+ * @brief Prints the tree structure with indentation based on depth (buffered, see exportTree)
  * @param pos The current node in traversal
  * @param depth The depth of the current node (for indentation)
  * @param isRight Whether the current node is a right child
@@ -133,27 +660,316 @@ public:
     void print(const Node* pos, int depth = 0, bool isRight = false);
 
     /**
- * @brief Searches for a node with the specified value
- * @param pos The current node in traversal (initially root)
+     * @brief Writes the tree as indented text, Graphviz DOT or JSON through one big buffer (nothing is flushed per node)
+     * @param out Where to write it (a file, a string stream, std::cout...)
+     * @param options The format, and the depth and key range limits (subtrees outside them aren't visited)
+     * @return Number of nodes written
+     */
+    std::size_t exportTree(std::ostream& out, const ExportOptions<Key>& options = {}) const;
+
+    /**
+ * @brief Searches for a node with the specified value (iteratively, with the tree's comparator)
+ * @param pos Root of the subtree to search (usually root)
  * @param data The value to search for
  * @return Pointer to the node if found, nullptr otherwise
  */
-    static Node* getNode(Node* pos, int data);
+    Node* getNode(Node* pos, const Key& data) const;
 
 
     /**
-     * @brief Recursively deletes all nodes in a subtree.
+     * @brief Recursively deletes all nodes in a subtree (returns them to the node pool).
      * @param node The root of the subtree to delete.
      */
     void deleteSubtree(Node *node);
 
-    ~RedBlackTree(); //destructor
+    /**
+     * @brief Sets the pool's live count from size() if a split left it unknown (before anything is freed, so it can't underflow)
+     */
+    void settleLive();
+
+    /**
+     * @brief Removes every node from the tree
+     */
+    void clear();
+
+    /**
+     * @brief Reserves room in the node pool so the next count inserts don't allocate
+     * @param count Number of nodes to reserve room for
+     */
+    void reserve(std::size_t count);
+
+    /**
+     * @brief Gets the number of bytes used by nodes currently in the tree
+     * @return Bytes in use
+     */
+    std::size_t bytesInUse() const;
+
+    /**
+     * @brief Gets the number of bytes the node pool has allocated (used or not)
+     * @return Bytes reserved
+     */
+    std::size_t bytesReserved() const;
+
+    /**
+     * @brief Gets the tree's operation counters and latency histograms (always zero unless built with RBT_STATS=1)
+     * @return Rotations, recolors, fixup rounds, comparisons, allocations and latencies since the last reset
+     */
+    const TreeStats& stats() const;
+
+    /**
+     * @brief Zeroes the counters and histograms (latency timing stays on or off)
+     */
+    void resetStats();
+
+    /**
+     * @brief Turns recording insert/remove/find latencies on or off (off by default, it reads the clock twice per
+     * operation). Does nothing unless built with RBT_STATS=1
+     */
+    void setLatencyTiming(bool on);
+
+    static constexpr bool statsEnabled = RBT_STATS != 0;
+
+    ~BasicRedBlackTree(); //destructor
 
 
     Node* root = nullptr; //root of tree
 
 private:
-    unsigned int checkTreeProperties(Node* parent, Node* node);
+    //A node validate() still has to check, with the bounds its ancestors put on its key
+    struct ValidationFrame {
+        const Node* node;
+        const Node* parent;
+        const Key* lower; //the key has to be greater than this (nullptr if there's no bound)
+        const Key* upper; //and less than this
+        std::size_t depth;
+        int blacks; //black nodes above it
+    };
+
+    /**
+     * @brief Checks a node's links to its children, red-red with them, their order and its subtree size
+     * @return The violation, None if the node is fine
+     */
+    TreeViolation checkNode(const Node* node) const;
+
+    /**
+     * @brief Checks the subtree under a frame depth first, with an explicit stack
+     * @param expectedBlacks Black nodes every path from the root to a null child has to pass through
+     * @param stop Set by whichever thread finds a violation first, the others give up soon after
+     * @param cut If not nullptr, frames at cutDepth are put here instead of being checked (to hand them to other threads)
+     */
+    void validateSubtree(ValidationFrame start, int expectedBlacks, std::atomic<bool>& stop,
+                         ValidationReport<Node>& report, std::vector<ValidationFrame>* cut, std::size_t cutDepth) const;
+
+    /**
+     * @brief Checks the nodes from node up to the root and aborts if any is broken (RBT_CHECK_PATHS builds check
+     * every insert and remove with this)
+     * @param node Lowest node the update changed (nullptr to check just the root)
+     */
+    void checkPath(const Node* node) const;
+
+    /**
+     * @brief Links a newly created node under parent, updates the bookkeeping and rebalances
+     * @param node The new node
+     * @param parent Parent of the new node (nullptr if it's the new root)
+     * @param dir Which child of parent the node becomes
+     */
+    void attach(Node* node, Node* parent, direction dir);
+
+    /**
+     * @brief Builds a perfectly balanced subtree out of a sorted range (middle key becomes the subtree root)
+     * @param begin Start of the keys for this subtree
+     * @param count Number of keys in this subtree
+     * @param parent Parent of the subtree root
+     * @param depth Depth of the subtree root
+     * @param redDepth Depth of the bottom (incomplete) level, whose nodes are colored red
+     * @return The subtree root
+     */
+    template <typename RandomIt>
+    Node* buildSorted(RandomIt begin, std::size_t count, Node* parent, unsigned int depth, unsigned int redDepth);
+
+    /**
+     * @brief Adds one to the count of a multiset key that's already in the tree
+     * @throws std::overflow_error if the count is full
+     */
+    void addCopy(Node* node) requires multiset;
+
+    /**
+     * @brief Creates a node and attaches it under parent
+     * @return Iterator to the new node
+     */
+    template <typename K, typename... Args>
+    iterator createAt(Node* parent, direction dir, K&& key, Args&&... args);
+
+    /**
+     * @brief Unlinks a node and rebalances, without freeing it or touching first, last and nodeCount
+     * @return The lowest node whose subtree lost a node (nullptr if toRemove was the root and had at most one child)
+     */
+    Node* detach(Node* toRemove);
+
+    /**
+     * @brief Counts the black nodes from node down to a null child (node included)
+     */
+    static int blackHeight(const Node* node);
+
+    /**
+     * @brief Joins two detached subtrees and a detached node between them (the result becomes root)
+     * @param leftRoot Subtree with the smaller keys (may be nullptr)
+     * @param leftHeight Black height of leftRoot
+     * @param key Node that goes between them
+     * @param rightRoot Subtree with the bigger keys (may be nullptr)
+     * @param rightHeight Black height of rightRoot
+     * @param height Set to the black height of the result
+     * @return Root of the joined subtree
+     */
+    Node* joinRoots(Node* leftRoot, int leftHeight, Node* key, Node* rightRoot, int rightHeight, int& height);
+
+    //The pieces splitRoots cuts a subtree into
+    struct SplitRoots {
+        Node* lower = nullptr;
+        int lowerHeight = 0;
+        Node* found = nullptr;
+        Node* upper = nullptr;
+        int upperHeight = 0;
+    };
+
+    /**
+     * @brief Splits a detached subtree at a key, joining the pieces beside the search path on the way back up. The
+     * heights are passed along so every join only costs the difference in height (O(log n) in total)
+     * @param node Root of the subtree
+     * @param height Black height of node
+     * @param key Key to split at
+     * @return Subtrees with the smaller and bigger keys, and the node holding key (detached) if there was one
+     */
+    SplitRoots splitRoots(Node* node, int height, const Key& key);
+
+    /**
+     * @brief Joins two detached subtrees without a key between them (the largest node of leftRoot is used as the key)
+     * @param height Set to the black height of the result
+     * @return Root of the joined subtree
+     */
+    Node* join2Roots(Node* leftRoot, int leftHeight, Node* rightRoot, int rightHeight, int& height);
+
+    //A detached subtree and its black height
+    struct Subtree {
+        Node* root = nullptr;
+        int height = 0;
+    };
+
+    enum class SetOperation { Union, Intersection, Difference };
+
+    /**
+     * @brief Runs a set operation on two detached subtrees. Nodes that don't make it into the result go in discarded
+     * (they're freed once every task is done, since the pool isn't thread safe). This tree's root is used as scratch
+     * space for the joins, so each parallel task runs on its own empty tree
+     * @return The resulting subtree
+     */
+    Subtree combine(SetOperation operation, Subtree a, Subtree b, std::vector<Node*>& discarded, ThreadPool* pool);
+
+    /**
+     * @brief Moves a and b into one tree, runs combine on their roots and frees the discarded nodes
+     */
+    static BasicRedBlackTree combineTrees(SetOperation operation, BasicRedBlackTree&& a, BasicRedBlackTree&& b,
+                                          ThreadPool* pool);
+
+    /**
+     * @brief Adds every node of a subtree to out (no recursion)
+     */
+    static void collectSubtree(Node* node, std::vector<Node*>& out);
+
+    /**
+     * @brief Sorts and deduplicates a batch with the tree's comparator
+     * @return The sorted keys (result.skipped counts the repeats)
+     */
+    std::vector<Key> sortedBatch(std::span<const Key> keys, BatchResult& result) const;
+
+    /**
+     * @brief Finds a key starting from a node with a smaller key: climbs to the first ancestor that is greater than the
+     * key (the key's spot is inside that subtree), then goes down. O(log d) for keys d positions apart
+     * @param finger Node with a key less than key (nullptr to start at the root)
+     * @param key Key to look for
+     * @param parent Set to the parent of the key's spot if it isn't in the tree
+     * @param dir Set to the side of parent the key goes on
+     * @return The node holding key, nullptr if it isn't in the tree
+     */
+    Node* findFrom(Node* finger, const Key& key, Node*& parent, direction& dir) const;
+
+    /**
+     * @brief Runs the interleaved lookups behind find_batch and contains_batch
+     * @param done Called with (index of the key, node holding it or nullptr) as each lookup finishes, in any order
+     */
+    template <typename F>
+    void lookupBatch(std::span<const Key> keys, F&& done) const;
+
+    /**
+     * @brief Compares two keys with the tree's comparator
+     * @return true if a comes before b
+     */
+    bool less(const Key& a, const Key& b) const {
+        RBT_STAT(statistics.comparisons++);
+        return compare(a, b);
+    }
+
+    /**
+     * @brief Recomputes the augmented data of one node from its children
+     */
+    static void refresh(Node* node) {
+        Augment::update(node);
+    }
+
+    /**
+     * @brief Recomputes the augmented data of a node and every ancestor (after its subtree gained or lost a node)
+     */
+    static void refreshUp(Node* node);
+
+    /**
+     * @brief Counts the keys that are less than key (or not greater than key if inclusive)
+     */
+    std::size_t countBelow(const Key& key, bool inclusive) const requires OrderStatisticAugment<Augment>;
+
+    /**
+     * @brief Walks a subtree for overlapping()
+     * @return false once the visitor asked to stop
+     */
+    template <typename F>
+    static bool visitOverlaps(const Node* node, const point_type& lo, const point_type& hi,
+                              F& visit, std::size_t& visited) requires IntervalAugment<Augment>;
+
+    static constexpr bool augmented = !std::is_same_v<Augment, NoAugment>;
+    static constexpr int parallelHeight = 10; //set operations only fork when both subtrees have this black height
+    static constexpr std::size_t rebuildRatio = 4; //batches at least 1/rebuildRatio of the tree's size rebuild it
+    static constexpr std::size_t batchWindow = 16; //lookups find_batch keeps in flight (about what a core can have missing)
+    static constexpr std::size_t parallelValidateSize = 1 << 16; //smaller trees are validated on the calling thread
+
+    [[no_unique_address]] Compare compare; //key ordering
+    Allocator<Node> pool; //owns the memory of every node in the tree
+    Node* first = nullptr; //smallest node (so begin() and hints at the front are O(1))
+    Node* last = nullptr; //largest node (so appending with a hint is O(1))
+    mutable std::size_t nodeCount = 0;
+    mutable bool countKnown = true; //false after a split (without SubtreeSize) until size() counts the nodes
+    bool liveKnown = true; //false after a split (without SubtreeSize) until settleLive() gives the pool its real count
+    mutable std::size_t copyCount = 0; //multisets: every node's count added up
+    mutable bool copiesKnown = true; //false after a split or erase_range until total_count() adds them up again
+#if RBT_STATS
+    mutable TreeStats statistics; //mutable so lookups can count their comparisons
+#endif
 };
 
+#include "RedBlackTree.tpp"
+
+//int sets are compiled once in RedBlackTree.cpp
+extern template class BasicRedBlackTree<int>;
+using RedBlackTree = BasicRedBlackTree<int>;
+
+//int tree with subtree sizes, for rank/select
+extern template class BasicRedBlackTree<int, EmptyValue, std::less<int>, NodePool, SubtreeSize>;
+using OrderStatisticTree = BasicRedBlackTree<int, EmptyValue, std::less<int>, NodePool, SubtreeSize>;
+
+//int multiset (repeated keys are counted in their node)
+extern template class BasicRedBlackTree<int, KeyCount>;
+using RedBlackMultiset = BasicRedBlackTree<int, KeyCount>;
+
+//int intervals keyed on their start, with the largest end of every subtree cached for overlap queries
+extern template class BasicRedBlackTree<Interval<int>, EmptyValue, std::less<Interval<int>>, NodePool, MaxEnd<int>>;
+using IntervalTree = BasicRedBlackTree<Interval<int>, EmptyValue, std::less<Interval<int>>, NodePool, MaxEnd<int>>;
+
 #endif
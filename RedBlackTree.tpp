@@ -0,0 +1,1844 @@
+//Definitions for BasicRedBlackTree (included at the bottom of RedBlackTree.h, don't include this directly)
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+#define RBT_TEMPLATE template <typename Key, typename Value, typename Compare, template <typename> class Allocator, typename Augment>
+#define RBT_CLASS BasicRedBlackTree<Key, Value, Compare, Allocator, Augment>
+
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree() = default;
+
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const Compare& compare) : compare(compare) {
+}
+
+//moving a tree hands over the whole pool, so node pointers stay valid
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(BasicRedBlackTree&& other) noexcept
+    : root(std::exchange(other.root, nullptr)), compare(std::move(other.compare)), pool(std::move(other.pool)),
+      first(std::exchange(other.first, nullptr)), last(std::exchange(other.last, nullptr)),
+      nodeCount(std::exchange(other.nodeCount, 0)), countKnown(std::exchange(other.countKnown, true)),
+      liveKnown(std::exchange(other.liveKnown, true)), copyCount(std::exchange(other.copyCount, 0)), copiesKnown(std::exchange(other.copiesKnown, true)) {
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::operator=(BasicRedBlackTree&& other) noexcept -> BasicRedBlackTree& {
+    if (this != &other) {
+        clear();
+        root = std::exchange(other.root, nullptr);
+        compare = std::move(other.compare);
+        pool = std::move(other.pool);
+        first = std::exchange(other.first, nullptr);
+        last = std::exchange(other.last, nullptr);
+        nodeCount = std::exchange(other.nodeCount, 0);
+        countKnown = std::exchange(other.countKnown, true);
+        liveKnown = std::exchange(other.liveKnown, true);
+        copyCount = std::exchange(other.copyCount, 0);
+        copiesKnown = std::exchange(other.copiesKnown, true);
+    }
+    return *this;
+}
+
+
+/*
+ * Requirements:
+ *  1 Every node is either red or black
+ *  2 All null nodes  are considered black.
+ *  3 A red node does not have a red child.
+ *  4 Every path from a given node to any of its leaf nodes goes through the same number of black nodes.
+ *  (Conclusion) If a node N has exactly one child, the child must be red, because if it were black, its leaves would sit at a different black depth than N's child, violating requirement 4.
+ */
+
+
+//https://en.wikipedia.org/wiki/Tree_rotation visualization
+//node passed in is the root of the subtree (perhaps rename a later
+//direction is the direction to rotate in
+RBT_TEMPLATE
+auto RBT_CLASS::rotateSubTree(Node* subRoot, const direction dir) -> Node* {
+    //Will rotate left or right.
+    RBT_STAT(statistics.rotations++);
+    Node* parent = subRoot->parent; //save the original root parent
+
+    //New root is now the subRoot's opposite child
+    //(of the direction passed in, so if we want to rotate left this would be the right child)
+    Node* newRoot = subRoot->child(1 - dir);
+
+    //swap the dir child of the subRoot and newRoot (swap rotation direction child over (the 'inner' child))
+    Node* newChild = newRoot->child(dir);
+    subRoot->setChild(1 - dir, newChild);
+
+    newRoot->setChild(dir, subRoot); //set subRoot as the newRoot's child
+
+    //update parents
+    if (newChild != nullptr) {
+        //for newChild
+        newChild->parent = subRoot;
+    }
+
+    newRoot->parent = parent; //for new root
+    subRoot->parent = newRoot; //for original subRoot
+
+    //subRoot is now below newRoot, so it gets recomputed first (the subtree as a whole holds the same nodes, so nothing above changes)
+    if constexpr (augmented) {
+        refresh(subRoot);
+        refresh(newRoot);
+    }
+
+
+    //update the children for parent
+    if (parent != nullptr) {
+        //if subRoot == parent->right, it evaluates to 1 which is the right direction (since right and left are basically booleans)
+        parent->setChild(subRoot == parent->right, newRoot);
+    } else {
+        root = newRoot;
+    }
+    return newRoot;
+}
+
+//Gets the direction of the node passed in relative to it's parent
+RBT_TEMPLATE
+direction RBT_CLASS::nodeDirection(const Node* node) {
+    if (node == nullptr || node->parent == nullptr) {
+        throw std::invalid_argument("Node direction error, node or parent is null when calling function");
+    }
+
+    if (node == node->parent->right) {
+        return right;
+    }
+    return left;
+}
+
+//basically because nullptr counts as black, use this function
+RBT_TEMPLATE
+Color RBT_CLASS::getColor(const Node* node) {
+    if (node == nullptr) {
+        return BLACK;
+    }
+    return node->color;
+}
+
+//u is the node to be swapped, and v is the node to swap with
+RBT_TEMPLATE
+void RBT_CLASS::transplant(Node* u, Node* v) {
+    if (u->parent == nullptr) {
+        //if u is root
+        root = v;
+    } else {
+        const direction dir = nodeDirection(u); //u's direction relative to parent
+        u->parent->setChild(dir, v); //replace the parent's child u, with v
+    }
+
+    if (v != nullptr) {
+        //update the parents
+        v->parent = u->parent;
+    }
+}
+
+
+//Finds the in order sucessor (leftmost child of right subtree). (like binary tree)
+RBT_TEMPLATE
+auto RBT_CLASS::tree_min(Node* node) -> Node* {
+    while (node->left != nullptr) {
+        node = node->left;
+    }
+    return node;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::tree_max(Node* node) -> Node* {
+    while (node->right != nullptr) {
+        node = node->right;
+    }
+    return node;
+}
+
+//Leftmost node of the right subtree, or else the first ancestor we reach from its left side
+RBT_TEMPLATE
+auto RBT_CLASS::successor(Node* node) -> Node* {
+    if (node->right != nullptr) {
+        return tree_min(node->right);
+    }
+    Node* parent = node->parent;
+    while (parent != nullptr && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+//Mirror of successor
+RBT_TEMPLATE
+auto RBT_CLASS::predecessor(Node* node) -> Node* {
+    if (node->left != nullptr) {
+        return tree_max(node->left);
+    }
+    Node* parent = node->parent;
+    while (parent != nullptr && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+
+//position initially is the root, prev is initially nullptr
+
+RBT_TEMPLATE
+void RBT_CLASS::insert(Node* & pos, Node* prev, const Key& data, const direction dir) {
+    if (pos == nullptr) {
+        pos = pool.create(data); //this will be the base case of the recursion (will insert once the path has ended)
+        RBT_STAT(statistics.allocations++);
+        attach(pos, prev, dir); //set parent node and do the actual insert
+        return;
+    }
+
+    //if data being inserted is greater than node then go right
+    if (less(pos->data, data)) {
+        insert(pos->right, pos, data, right);
+    } else if (less(data, pos->data)) {
+        //If data being inserted is less than node go left
+        insert(pos->left, pos, data, left);
+    } else if constexpr (multiset) {
+        addCopy(pos); //the number is already in the tree, count it again
+    } else {
+        //if the number is already in the tree (neither is less than the other)
+        std::cout << "Already in the tree" << std::endl;
+    }
+}
+
+//Same as insert, but goes down the tree with a loop and builds the mapped value right inside the new node
+RBT_TEMPLATE
+template <typename K, typename... Args>
+auto RBT_CLASS::emplace(K&& key, Args&&... args) -> std::pair<iterator, bool> {
+    RBT_STAT(const StatTimer timer(statistics.insertLatency, statistics.timing));
+    Node* parent = nullptr;
+    Node* pos = root;
+    direction dir = right;
+
+    while (pos != nullptr) {
+        parent = pos;
+        if (less(key, pos->data)) {
+            dir = left;
+        } else if (less(pos->data, key)) {
+            dir = right;
+        } else {
+            if constexpr (multiset) {
+                addCopy(pos); //just count it, the tree's shape doesn't change
+            }
+            return {iterator(pos, this), false}; //already in the tree
+        }
+        pos = pos->child(dir);
+    }
+
+    return {createAt(parent, dir, std::forward<K>(key), std::forward<Args>(args)...), true};
+}
+
+/*
+ * Checks if the key fits between the hint and its neighbour. If it does, the new node goes in the empty child slot
+ * between them: the hint's own child if it's free, otherwise the neighbour's (one of the two is always empty).
+ * first and last are cached so the neighbour lookup is O(1) at either end of the tree.
+ */
+RBT_TEMPLATE
+template <typename K, typename... Args>
+auto RBT_CLASS::emplace_hint(iterator hint, K&& key, Args&&... args) -> iterator {
+    Node* pos = hint.current;
+
+    if (root == nullptr) {
+        return createAt(nullptr, right, std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    if (pos == nullptr) {
+        //end() hint, the key should come after the largest node
+        if (less(last->data, key)) {
+            return createAt(last, right, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+    } else if (less(key, pos->data)) {
+        //key goes before the hint
+        Node* prev = pos == first ? nullptr : predecessor(pos);
+        if (prev == nullptr || less(prev->data, key)) {
+            if (pos->left == nullptr) {
+                return createAt(pos, left, std::forward<K>(key), std::forward<Args>(args)...);
+            }
+            return createAt(prev, right, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+    } else if (less(pos->data, key)) {
+        //key goes after the hint
+        Node* next = pos == last ? nullptr : successor(pos);
+        if (next == nullptr || less(key, next->data)) {
+            if (pos->right == nullptr) {
+                return createAt(pos, right, std::forward<K>(key), std::forward<Args>(args)...);
+            }
+            return createAt(next, left, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+    } else {
+        if constexpr (multiset) {
+            addCopy(pos);
+        }
+        return hint; //the hint is the key
+    }
+
+    //bad hint, just insert from the root
+    return emplace(std::forward<K>(key), std::forward<Args>(args)...).first;
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::addCopy(Node* node) requires multiset {
+    if (node->value.count == std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("multiset: a key can't have more than 2^32 - 1 copies");
+    }
+    node->value.count++;
+    copyCount++;
+}
+
+RBT_TEMPLATE
+template <typename K, typename... Args>
+auto RBT_CLASS::createAt(Node* parent, const direction dir, K&& key, Args&&... args) -> iterator {
+    Node* node = pool.create(std::forward<K>(key), std::forward<Args>(args)...);
+    RBT_STAT(statistics.allocations++);
+    attach(node, parent, dir);
+    return iterator(node, this);
+}
+
+/*
+ * Splitting at the middle every time puts every null child at depth h or h + 1, where h = floor(log2(n + 1)).
+ * So levels 0 to h - 1 are full and can all be black, and the nodes on level h (if there are any) are colored red:
+ *  -every path to a null child passes through exactly h black nodes (requirement 4)
+ *  -the red nodes are leaves with black parents (requirement 3)
+ */
+RBT_TEMPLATE
+template <typename RandomIt>
+void RBT_CLASS::assignSorted(RandomIt begin, RandomIt end) {
+    clear();
+    const auto count = static_cast<std::size_t>(std::distance(begin, end));
+    if (count == 0) {
+        return;
+    }
+    pool.reserve(count);
+
+    unsigned int redDepth = 0; //floor(log2(count + 1))
+    while ((std::size_t(2) << redDepth) - 1 <= count) {
+        redDepth++;
+    }
+
+    root = buildSorted(begin, count, nullptr, 0, redDepth);
+    first = tree_min(root);
+    last = tree_max(root);
+    copyCount = count;
+}
+
+RBT_TEMPLATE
+template <typename RandomIt>
+auto RBT_CLASS::buildSorted(RandomIt begin, const std::size_t count, Node* parent, const unsigned int depth,
+                            const unsigned int redDepth) -> Node* {
+    if (count == 0) {
+        return nullptr;
+    }
+
+    const std::size_t middle = count / 2;
+    Node* node = pool.create(*(begin + middle));
+    RBT_STAT(statistics.allocations++);
+    node->parent = parent;
+    node->color = depth == redDepth ? RED : BLACK;
+    nodeCount++;
+
+    node->left = buildSorted(begin, middle, node, depth + 1, redDepth);
+    node->right = buildSorted(begin + middle + 1, count - middle - 1, node, depth + 1, redDepth);
+    if constexpr (augmented) {
+        refresh(node);
+    }
+    return node;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::sortedBatch(std::span<const Key> keys, BatchResult& result) const -> std::vector<Key> {
+    std::vector<Key> sorted(keys.begin(), keys.end());
+    const auto byKey = [this](const Key& a, const Key& b) { return less(a, b); };
+    if (!std::is_sorted(sorted.begin(), sorted.end(), byKey)) {
+        std::sort(sorted.begin(), sorted.end(), byKey);
+    }
+    //sorted, so a key is a repeat if it isn't greater than the one before it
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [this](const Key& a, const Key& b) { return !less(a, b); }),
+                 sorted.end());
+    result.skipped = keys.size() - sorted.size();
+    return sorted;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::findFrom(Node* finger, const Key& key, Node*& parent, direction& dir) const -> Node* {
+    Node* pos = finger != nullptr ? finger : root;
+    //every key in pos's subtree is already known to be above pos's lower limit (finger is in it and is less than key),
+    //so once pos is greater than key, key's spot has to be somewhere under pos
+    while (pos != root && !less(key, pos->data)) {
+        pos = pos->parent;
+    }
+
+    parent = nullptr;
+    dir = right;
+    while (pos != nullptr) {
+        parent = pos;
+        if (less(key, pos->data)) {
+            dir = left;
+        } else if (less(pos->data, key)) {
+            dir = right;
+        } else {
+            return pos;
+        }
+        pos = pos->child(dir);
+    }
+    return nullptr;
+}
+
+RBT_TEMPLATE
+BatchResult RBT_CLASS::insert_batch(std::span<const Key> keys) {
+    BatchResult result;
+    if constexpr (multiset) {
+        //every repeat counts, so the batch can't be deduplicated
+        for (const Key& key : keys) {
+            emplace(key).second ? result.applied++ : result.skipped++;
+        }
+        return result;
+    }
+    const std::vector<Key> sorted = sortedBatch(keys, result);
+
+    if constexpr (std::is_same_v<Value, EmptyValue>) {
+        if (sorted.size() * rebuildRatio >= size()) {
+            //big batch: one merge with the keys already in the tree and an O(n + m) rebuild beats m rebalancing inserts
+            std::vector<Key> merged;
+            merged.reserve(nodeCount + sorted.size());
+            std::set_union(begin(), end(), sorted.begin(), sorted.end(), std::back_inserter(merged),
+                           [this](const Key& a, const Key& b) { return less(a, b); });
+            result.applied = merged.size() - nodeCount;
+            result.skipped += sorted.size() - result.applied;
+            assignSorted(merged.begin(), merged.end());
+            return result;
+        }
+    }
+
+    Node* finger = nullptr;
+    for (const Key& key : sorted) {
+        Node* parent;
+        direction dir;
+        Node* found = findFrom(finger, key, parent, dir);
+        if (found != nullptr) {
+            result.skipped++;
+            finger = found;
+        } else {
+            finger = createAt(parent, dir, key).node();
+            result.applied++;
+        }
+    }
+    return result;
+}
+
+//The finger is the removed key's predecessor: it stays in the tree and is still less than the next key in the batch
+RBT_TEMPLATE
+BatchResult RBT_CLASS::erase_batch(std::span<const Key> keys) {
+    BatchResult result;
+    if constexpr (multiset) {
+        for (const Key& key : keys) {
+            erase(key) ? result.applied++ : result.skipped++;
+        }
+        return result;
+    }
+    const std::vector<Key> sorted = sortedBatch(keys, result);
+
+    if constexpr (std::is_same_v<Value, EmptyValue>) {
+        if (sorted.size() * rebuildRatio >= size()) {
+            std::vector<Key> kept;
+            kept.reserve(nodeCount);
+            std::set_difference(begin(), end(), sorted.begin(), sorted.end(), std::back_inserter(kept),
+                                [this](const Key& a, const Key& b) { return less(a, b); });
+            result.applied = nodeCount - kept.size();
+            result.skipped += sorted.size() - result.applied;
+            assignSorted(kept.begin(), kept.end());
+            return result;
+        }
+    }
+
+    Node* finger = nullptr;
+    for (const Key& key : sorted) {
+        Node* parent;
+        direction dir;
+        Node* found = findFrom(finger, key, parent, dir);
+        if (found == nullptr) {
+            result.skipped++;
+            if (parent != nullptr) {
+                //parent is the key's neighbour: use it if it's below the key, otherwise its predecessor is
+                finger = dir == right ? parent : predecessor(parent);
+            }
+        } else {
+            finger = found == first ? nullptr : predecessor(found);
+            remove(found);
+            result.applied++;
+        }
+    }
+    return result;
+}
+
+RBT_TEMPLATE
+int RBT_CLASS::blackHeight(const Node* node) {
+    int height = 0;
+    for (; node != nullptr; node = node->left) {
+        if (node->color == BLACK) {
+            height++;
+        }
+    }
+    return height;
+}
+
+/*
+ * If the trees are the same height, key just becomes a black root over both of them. Otherwise key goes down the
+ * taller tree's inner edge (the right edge of left, or the left edge of right) until it reaches a black subtree exactly
+ * as tall as the shorter tree. key replaces it as a red node with that subtree and the shorter tree as children, so
+ * every path keeps its black count and only a red-red with key's parent is left, which insertBalance fixes.
+ */
+RBT_TEMPLATE
+auto RBT_CLASS::joinRoots(Node* leftRoot, int leftHeight, Node* key, Node* rightRoot, int rightHeight, int& height)
+    -> Node* {
+    //black roots mean key can never end up over a red subtree root
+    if (getColor(leftRoot) == RED) {
+        leftRoot->color = BLACK;
+        leftHeight++;
+    }
+    if (getColor(rightRoot) == RED) {
+        rightRoot->color = BLACK;
+        rightHeight++;
+    }
+    key->parent = nullptr;
+
+    if (leftHeight == rightHeight) {
+        key->left = leftRoot;
+        key->right = rightRoot;
+        for (Node* child : {leftRoot, rightRoot}) {
+            if (child != nullptr) {
+                child->parent = key;
+            }
+        }
+        key->color = BLACK;
+        if constexpr (augmented) {
+            refresh(key);
+        }
+        root = key;
+        height = leftHeight + 1;
+        return key;
+    }
+
+    const direction dir = leftHeight > rightHeight ? right : left; //which edge of the taller tree to go down
+    Node* tall = dir == right ? leftRoot : rightRoot;
+    Node* shortRoot = dir == right ? rightRoot : leftRoot;
+    const int shortHeight = std::min(leftHeight, rightHeight);
+    height = std::max(leftHeight, rightHeight);
+
+    Node* parent = nullptr;
+    Node* pos = tall;
+    int posHeight = height;
+    while (pos != nullptr && (pos->color == RED || posHeight > shortHeight)) {
+        if (pos->color == BLACK) {
+            posHeight--;
+        }
+        parent = pos;
+        pos = pos->child(dir);
+    }
+
+    key->setChild(1 - dir, pos);
+    key->setChild(dir, shortRoot);
+    for (Node* child : {pos, shortRoot}) {
+        if (child != nullptr) {
+            child->parent = key;
+        }
+    }
+    key->parent = parent;
+    parent->setChild(dir, key);
+    key->color = RED;
+    root = tall;
+    if constexpr (augmented) {
+        refresh(key);
+        refreshUp(parent);
+    }
+
+    //the tree only gets taller if case 2 pushes the red all the way up, which turns the root's other child black
+    Node* outer = tall->child(1 - dir);
+    const bool outerWasRed = getColor(outer) == RED;
+    insertBalance(key, dir);
+    if (root == tall && outerWasRed && getColor(outer) == BLACK) {
+        height++;
+    }
+    return root;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::splitRoots(Node* node, const int height, const Key& key) -> SplitRoots {
+    if (node == nullptr) {
+        return {};
+    }
+    Node* leftChild = node->left;
+    Node* rightChild = node->right;
+    const int childHeight = height - (node->color == BLACK ? 1 : 0);
+    for (Node* child : {leftChild, rightChild}) {
+        if (child != nullptr) {
+            child->parent = nullptr;
+        }
+    }
+
+    if (less(key, node->data)) {
+        SplitRoots parts = splitRoots(leftChild, childHeight, key);
+        parts.upper = joinRoots(parts.upper, parts.upperHeight, node, rightChild, childHeight, parts.upperHeight);
+        return parts;
+    }
+    if (less(node->data, key)) {
+        SplitRoots parts = splitRoots(rightChild, childHeight, key);
+        parts.lower = joinRoots(leftChild, childHeight, node, parts.lower, parts.lowerHeight, parts.lowerHeight);
+        return parts;
+    }
+    node->left = nullptr;
+    node->right = nullptr;
+    return {leftChild, childHeight, node, rightChild, childHeight};
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::join(BasicRedBlackTree&& left, const Key& key, BasicRedBlackTree&& right) -> BasicRedBlackTree {
+    if ((left.last != nullptr && !left.less(left.last->data, key)) ||
+        (right.first != nullptr && !left.less(key, right.first->data))) {
+        throw std::invalid_argument("join: every key in left must be less than key, and key less than every key in right");
+    }
+    Node* rightRoot = std::exchange(right.root, nullptr);
+    Node* rightLast = std::exchange(right.last, nullptr);
+    right.first = nullptr;
+
+    BasicRedBlackTree result(std::move(left));
+    result.pool.adopt(right.pool);
+    Node* node = result.pool.create(key);
+    RBT_STAT(result.statistics.allocations++);
+    int height;
+    result.joinRoots(result.root, blackHeight(result.root), node, rightRoot, blackHeight(rightRoot), height);
+
+    result.first = result.first != nullptr ? result.first : node;
+    result.last = rightLast != nullptr ? rightLast : node;
+    result.nodeCount += right.nodeCount + 1;
+    result.countKnown = result.countKnown && right.countKnown;
+    result.liveKnown = result.liveKnown && right.liveKnown;
+    result.copyCount += right.copyCount + 1;
+    result.copiesKnown = result.copiesKnown && right.copiesKnown;
+    right.nodeCount = 0;
+    right.countKnown = true;
+    right.liveKnown = true;
+    right.copyCount = 0;
+    right.copiesKnown = true;
+    return result;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::join2Roots(Node* leftRoot, const int leftHeight, Node* rightRoot, const int rightHeight, int& height)
+    -> Node* {
+    if (leftRoot == nullptr) {
+        height = rightHeight;
+        return rightRoot;
+    }
+    if (rightRoot == nullptr) {
+        height = leftHeight;
+        return leftRoot;
+    }
+    root = leftRoot;
+    Node* middle = tree_max(leftRoot);
+    detach(middle);
+    return joinRoots(root, blackHeight(root), middle, rightRoot, rightHeight, height);
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::join2(BasicRedBlackTree&& left, BasicRedBlackTree&& right) -> BasicRedBlackTree {
+    if (left.root != nullptr && right.root != nullptr && !left.less(left.last->data, right.first->data)) {
+        throw std::invalid_argument("join2: every key in left must be less than every key in right");
+    }
+    Node* rightRoot = std::exchange(right.root, nullptr);
+    Node* rightFirst = std::exchange(right.first, nullptr);
+    Node* rightLast = std::exchange(right.last, nullptr);
+
+    BasicRedBlackTree result(std::move(left));
+    result.pool.adopt(right.pool);
+    int height;
+    result.root = result.join2Roots(result.root, blackHeight(result.root), rightRoot, blackHeight(rightRoot), height);
+    result.first = result.first != nullptr ? result.first : rightFirst;
+    result.last = rightLast != nullptr ? rightLast : result.last;
+    result.nodeCount += right.nodeCount;
+    result.countKnown = result.countKnown && right.countKnown;
+    result.liveKnown = result.liveKnown && right.liveKnown;
+    result.copyCount += right.copyCount;
+    result.copiesKnown = result.copiesKnown && right.copiesKnown;
+    right.nodeCount = 0;
+    right.countKnown = true;
+    right.liveKnown = true;
+    right.copyCount = 0;
+    right.copiesKnown = true;
+    return result;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::split(const Key& key) -> std::tuple<BasicRedBlackTree, std::optional<Value>, BasicRedBlackTree> {
+    BasicRedBlackTree lower(compare);
+    BasicRedBlackTree upper(compare);
+    std::optional<Value> found;
+    if (root == nullptr) {
+        return {std::move(lower), std::move(found), std::move(upper)};
+    }
+
+    const SplitRoots parts = splitRoots(root, blackHeight(root), key);
+    //upper's nodes stay in this pool's slabs, so it takes the same share of the reservation as it has of the nodes
+    //(counted with SubtreeSize, otherwise estimated from black heights: a half of black height h has 2^h-1 to 4^h-1 nodes)
+    const auto weight = [](const Node* half) -> std::size_t {
+        if (half == nullptr) {
+            return 0;
+        }
+        if constexpr (OrderStatisticAugment<Augment>) {
+            return half->aug.size;
+        } else {
+            return std::size_t(1) << blackHeight(half);
+        }
+    };
+    const std::size_t upperWeight = weight(parts.upper);
+    const std::size_t totalWeight = weight(parts.lower) + upperWeight;
+    const double upperShare = totalWeight == 0 ? 0.0 : static_cast<double>(upperWeight) / static_cast<double>(totalWeight);
+    upper.pool.share(pool, static_cast<std::size_t>(static_cast<double>(pool.capacity()) * upperShare));
+    lower.pool = std::move(pool);
+    if (parts.found != nullptr) {
+        found.emplace(std::move(parts.found->value));
+        lower.pool.destroy(parts.found);
+        RBT_STAT(lower.statistics.frees++);
+    }
+
+    lower.root = parts.lower;
+    upper.root = parts.upper;
+    for (BasicRedBlackTree* half : {&lower, &upper}) {
+        if (half->root == nullptr) {
+            continue;
+        }
+        half->root->color = BLACK;
+        //the smallest key goes to lower and the largest to upper (unless they were the split key)
+        half->first = half == &lower ? first : tree_min(half->root);
+        half->last = half == &upper ? last : tree_max(half->root);
+        if constexpr (OrderStatisticAugment<Augment>) {
+            half->nodeCount = half->root->aug.size;
+        } else {
+            half->countKnown = false;
+            half->liveKnown = false; //lower's pool still counts upper's nodes until settleLive()
+        }
+        half->copiesKnown = false;
+    }
+    if constexpr (OrderStatisticAugment<Augment>) {
+        lower.pool.setLive(lower.nodeCount);
+        upper.pool.setLive(upper.nodeCount);
+    }
+
+    root = nullptr;
+    first = nullptr;
+    last = nullptr;
+    nodeCount = 0;
+    countKnown = true;
+    liveKnown = true;
+    copyCount = 0;
+    copiesKnown = true;
+    return {std::move(lower), std::move(found), std::move(upper)};
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::collectSubtree(Node* node, std::vector<Node*>& out) {
+    if (node == nullptr) {
+        return;
+    }
+    //out doubles as the work list: everything after next still needs its children added
+    std::size_t next = out.size();
+    out.push_back(node);
+    for (; next < out.size(); next++) {
+        for (Node* child : {out[next]->left, out[next]->right}) {
+            if (child != nullptr) {
+                out.push_back(child);
+            }
+        }
+    }
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::combine(const SetOperation operation, const Subtree a, const Subtree b, std::vector<Node*>& discarded,
+                        ThreadPool* pool) -> Subtree {
+    if (a.root == nullptr || b.root == nullptr) {
+        //nothing left to match up: a union keeps whichever side is left, a difference keeps a, an intersection nothing
+        if (operation == SetOperation::Union) {
+            return a.root != nullptr ? a : b;
+        }
+        collectSubtree(b.root, discarded);
+        if (operation == SetOperation::Difference) {
+            return a;
+        }
+        collectSubtree(a.root, discarded);
+        return {};
+    }
+
+    //the pivot is a's root (b's root for a difference), the other tree is split at its key
+    const bool splitA = operation == SetOperation::Difference;
+    const Subtree pivotTree = splitA ? b : a;
+    const Subtree otherTree = splitA ? a : b;
+    Node* pivot = pivotTree.root;
+    const int childHeight = pivotTree.height - (pivot->color == BLACK ? 1 : 0);
+    const Subtree pivotLeft{pivot->left, childHeight};
+    const Subtree pivotRight{pivot->right, childHeight};
+    for (Node* child : {pivot->left, pivot->right}) {
+        if (child != nullptr) {
+            child->parent = nullptr;
+        }
+    }
+
+    const SplitRoots parts = splitRoots(otherTree.root, otherTree.height, pivot->data);
+    const Subtree otherLeft{parts.lower, parts.lowerHeight};
+    const Subtree otherRight{parts.upper, parts.upperHeight};
+    if (parts.found != nullptr) {
+        discarded.push_back(parts.found); //b's copy of a kept key, or a key being taken out of a
+    }
+
+    Subtree lower;
+    Subtree upper;
+    const auto combineLower = [&] {
+        lower = splitA ? combine(operation, otherLeft, pivotLeft, discarded, pool)
+                       : combine(operation, pivotLeft, otherLeft, discarded, pool);
+    };
+    if (pool != nullptr && std::min(a.height, b.height) >= parallelHeight) {
+        std::vector<Node*> upperDiscarded;
+        BasicRedBlackTree scratch(compare); //the other half runs on its own tree so the two don't share counters
+        pool->invoke(combineLower, [&] {
+            upper = splitA ? scratch.combine(operation, otherRight, pivotRight, upperDiscarded, pool)
+                           : scratch.combine(operation, pivotRight, otherRight, upperDiscarded, pool);
+            scratch.root = nullptr; //the nodes aren't scratch's to free
+        });
+        RBT_STAT(statistics += scratch.statistics);
+        discarded.insert(discarded.end(), upperDiscarded.begin(), upperDiscarded.end());
+    } else {
+        combineLower();
+        upper = splitA ? combine(operation, otherRight, pivotRight, discarded, pool)
+                       : combine(operation, pivotRight, otherRight, discarded, pool);
+    }
+
+    Subtree result;
+    if (operation == SetOperation::Union || (operation == SetOperation::Intersection && parts.found != nullptr)) {
+        result.root = joinRoots(lower.root, lower.height, pivot, upper.root, upper.height, result.height);
+    } else {
+        discarded.push_back(pivot);
+        result.root = join2Roots(lower.root, lower.height, upper.root, upper.height, result.height);
+    }
+    return result;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::combineTrees(const SetOperation operation, BasicRedBlackTree&& a, BasicRedBlackTree&& b,
+                             ThreadPool* pool) -> BasicRedBlackTree {
+    const std::size_t totalCount = a.size() + b.size();
+    a.settleLive();
+    b.settleLive();
+    BasicRedBlackTree result(std::move(a));
+    result.pool.adopt(b.pool);
+    Node* aRoot = std::exchange(result.root, nullptr);
+    Node* bRoot = std::exchange(b.root, nullptr);
+    b.first = nullptr;
+    b.last = nullptr;
+    b.nodeCount = 0;
+    b.countKnown = true;
+
+    std::vector<Node*> discarded;
+    const Subtree combined = result.combine(operation, {aRoot, blackHeight(aRoot)}, {bRoot, blackHeight(bRoot)},
+                                            discarded, pool);
+    for (Node* node : discarded) {
+        result.pool.destroy(node);
+    }
+    RBT_STAT(result.statistics.frees += discarded.size());
+
+    result.root = combined.root;
+    if (result.root != nullptr) {
+        result.root->color = BLACK;
+    }
+    result.first = result.root != nullptr ? tree_min(result.root) : nullptr;
+    result.last = result.root != nullptr ? tree_max(result.root) : nullptr;
+    result.nodeCount = totalCount - discarded.size();
+    result.countKnown = true;
+    return result;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::set_union(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool) -> BasicRedBlackTree
+    requires (!multiset) {
+    return combineTrees(SetOperation::Union, std::move(a), std::move(b), pool);
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::set_intersection(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool)
+    -> BasicRedBlackTree requires (!multiset) {
+    return combineTrees(SetOperation::Intersection, std::move(a), std::move(b), pool);
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::set_difference(BasicRedBlackTree&& a, BasicRedBlackTree&& b, ThreadPool* pool) -> BasicRedBlackTree
+    requires (!multiset) {
+    return combineTrees(SetOperation::Difference, std::move(a), std::move(b), pool);
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::attach(Node* node, Node* parent, const direction dir) {
+    node->parent = parent;
+    if (parent != nullptr) {
+        parent->setChild(dir, node);
+    }
+
+    //a new node is always a leaf, so it only changes the ends of the tree if it hangs off one of them
+    if (parent == nullptr) {
+        first = node;
+        last = node;
+    } else if (dir == left && parent == first) {
+        first = node;
+    } else if (dir == right && parent == last) {
+        last = node;
+    }
+    nodeCount++;
+    if constexpr (multiset) {
+        copyCount += node->value.count;
+    }
+
+    if constexpr (augmented) {
+        refreshUp(node); //the new leaf and every ancestor (the rotations in insertBalance fix up their own nodes)
+    }
+
+    insertBalance(node, dir); //links the node to its parent (or makes it the root) and rebalances
+#if RBT_CHECK_PATHS
+    checkPath(node);
+#endif
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::find(const Key& key) const -> iterator {
+    RBT_STAT(const StatTimer timer(statistics.findLatency, statistics.timing));
+    Node* pos = root;
+    while (pos != nullptr) {
+        if (less(key, pos->data)) {
+            pos = pos->left;
+        } else if (less(pos->data, key)) {
+            pos = pos->right;
+        } else {
+            return iterator(pos, this);
+        }
+    }
+    return end();
+}
+
+RBT_TEMPLATE
+template <typename F>
+void RBT_CLASS::lookupBatch(std::span<const Key> keys, F&& done) const {
+    Node* pos[batchWindow]; //where each lookup in flight is
+    std::size_t index[batchWindow]; //which key it is looking for
+    std::size_t active = 0;
+    std::size_t next = 0;
+    while (active < batchWindow && next < keys.size()) {
+        pos[active] = root;
+        index[active++] = next++;
+    }
+
+    while (active > 0) {
+        for (std::size_t slot = 0; slot < active;) {
+            Node* node = pos[slot];
+            const Key& key = keys[index[slot]];
+            if (node != nullptr && less(key, node->data)) {
+                pos[slot] = node->left;
+            } else if (node != nullptr && less(node->data, key)) {
+                pos[slot] = node->right;
+            } else {
+                done(index[slot], node); //found it, or fell off the tree
+                if (next < keys.size()) {
+                    //start the next key in this slot (the root is always in cache)
+                    pos[slot] = root;
+                    index[slot] = next++;
+                } else {
+                    //nothing left to start, move the last lookup in flight into this slot and look at it next
+                    active--;
+                    pos[slot] = pos[active];
+                    index[slot] = index[active];
+                    continue;
+                }
+            }
+#if defined(__GNUC__)
+            __builtin_prefetch(pos[slot]); //by the time the round comes back to this slot the node should be in cache
+#endif
+            slot++;
+        }
+    }
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::find_batch(std::span<const Key> keys, std::span<iterator> results) const {
+    if (results.size() < keys.size()) {
+        throw std::invalid_argument("RedBlackTree::find_batch: results is shorter than keys");
+    }
+    lookupBatch(keys, [&](const std::size_t index, Node* node) { results[index] = iterator(node, this); });
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::contains_batch(std::span<const Key> keys, std::span<bool> results) const {
+    if (results.size() < keys.size()) {
+        throw std::invalid_argument("RedBlackTree::contains_batch: results is shorter than keys");
+    }
+    std::size_t found = 0;
+    lookupBatch(keys, [&](const std::size_t index, Node* node) {
+        results[index] = node != nullptr;
+        found += node != nullptr ? 1 : 0;
+    });
+    return found;
+}
+
+//Every time we go left, the node is a candidate (it's not less than key), the last candidate is the answer
+RBT_TEMPLATE
+auto RBT_CLASS::lower_bound(const Key& key) const -> iterator {
+    Node* pos = root;
+    Node* candidate = nullptr;
+    while (pos != nullptr) {
+        if (less(pos->data, key)) {
+            pos = pos->right;
+        } else {
+            candidate = pos;
+            pos = pos->left;
+        }
+    }
+    return iterator(candidate, this);
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::upper_bound(const Key& key) const -> iterator {
+    Node* pos = root;
+    Node* candidate = nullptr;
+    while (pos != nullptr) {
+        if (less(key, pos->data)) {
+            candidate = pos;
+            pos = pos->left;
+        } else {
+            pos = pos->right;
+        }
+    }
+    return iterator(candidate, this);
+}
+
+//Mirror of upper_bound: every time we go right, the node is a candidate
+RBT_TEMPLATE
+auto RBT_CLASS::floor(const Key& key) const -> iterator {
+    Node* pos = root;
+    Node* candidate = nullptr;
+    while (pos != nullptr) {
+        if (less(key, pos->data)) {
+            pos = pos->left;
+        } else {
+            candidate = pos;
+            pos = pos->right;
+        }
+    }
+    return iterator(candidate, this);
+}
+
+RBT_TEMPLATE
+template <typename F>
+void RBT_CLASS::for_each_in_range(const Key& lo, const Key& hi, F&& fn) const {
+    if (less(hi, lo)) {
+        return;
+    }
+    Node* pos = lower_bound(lo).current;
+    while (pos != nullptr && !less(hi, pos->data)) {
+        fn(*pos);
+        pos = pos == last ? nullptr : successor(pos);
+    }
+}
+
+RBT_TEMPLATE
+BasicFrozenTree<Key, Compare> RBT_CLASS::freeze() const {
+    BasicFrozenTree<Key, Compare> frozen(compare);
+    frozen.assign(begin(), size());
+    return frozen;
+}
+
+//Going down towards the key: every time we go right, the left subtree and the node itself are below the key
+RBT_TEMPLATE
+std::size_t RBT_CLASS::countBelow(const Key& key, const bool inclusive) const requires OrderStatisticAugment<Augment> {
+    std::size_t count = 0;
+    const Node* pos = root;
+    while (pos != nullptr) {
+        if (less(pos->data, key) || (inclusive && !less(key, pos->data))) {
+            count += Augment::sizeOf(pos->left) + 1;
+            pos = pos->right;
+        } else {
+            pos = pos->left;
+        }
+    }
+    return count;
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::rank(const Key& key) const requires OrderStatisticAugment<Augment> {
+    return countBelow(key, false);
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::count_range(const Key& lo, const Key& hi) const requires OrderStatisticAugment<Augment> {
+    if (less(hi, lo)) {
+        return 0;
+    }
+    return countBelow(hi, true) - countBelow(lo, false);
+}
+
+RBT_TEMPLATE
+template <typename F>
+std::size_t RBT_CLASS::overlapping(const point_type& lo, const point_type& hi,
+                                   F&& visit) const requires IntervalAugment<Augment> {
+    std::size_t visited = 0;
+    if (!(hi < lo)) {
+        visitOverlaps(root, lo, hi, visit, visited);
+    }
+    return visited;
+}
+
+//Everything in a subtree whose largest end is below lo ends too early, and everything right of a node that starts
+//after hi starts too late, so neither is walked
+RBT_TEMPLATE
+template <typename F>
+bool RBT_CLASS::visitOverlaps(const Node* node, const point_type& lo, const point_type& hi,
+                              F& visit, std::size_t& visited) requires IntervalAugment<Augment> {
+    while (node != nullptr && !(node->aug.maxEnd < lo)) {
+        if (!visitOverlaps(node->left, lo, hi, visit, visited)) {
+            return false;
+        }
+        if (hi < node->data.start) {
+            return true;
+        }
+        if (!(node->data.end < lo)) {
+            visited++;
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, const Key&>, bool>) {
+                if (!visit(std::as_const(node->data))) {
+                    return false;
+                }
+            } else {
+                visit(std::as_const(node->data));
+            }
+        }
+        node = node->right; //loop instead of recursing, so the stack only grows with left turns
+    }
+    return true;
+}
+
+//Compare k with the size of the left subtree to decide which way to go
+RBT_TEMPLATE
+auto RBT_CLASS::select(std::size_t k) const -> iterator requires OrderStatisticAugment<Augment> {
+    Node* pos = root;
+    while (pos != nullptr) {
+        const std::size_t leftSize = Augment::sizeOf(pos->left);
+        if (k < leftSize) {
+            pos = pos->left;
+        } else if (k == leftSize) {
+            return iterator(pos, this);
+        } else {
+            k -= leftSize + 1;
+            pos = pos->right;
+        }
+    }
+    return end();
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::refreshUp(Node* node) {
+    while (node != nullptr) {
+        refresh(node);
+        node = node->parent;
+    }
+}
+
+// Corrected method definitions
+RBT_TEMPLATE
+void RBT_CLASS::insertBalance(Node* node, direction dir) {
+    Node* parent = node->parent;
+
+    if (parent == nullptr) {
+        node->color = BLACK;
+        RBT_STAT(statistics.recolors++);
+        root = node; //if there aren't any other nodes in the tree then this node is root
+        return;
+    }
+
+
+    Node* grandparent = nullptr;
+    Node* uncle = nullptr;
+
+    parent->setChild(dir, node); //update the parent's child to passed in node
+
+    //Now do the balancing
+
+    //recursion or iteration....
+    do {
+        RBT_STAT(statistics.insertFixups++);
+        grandparent = parent->parent;
+        //Case 1 (requirements are good)
+        if (parent->color == BLACK) {
+            return; //requirements hold
+        }
+
+        //case 4: Parent is red and the root, but the passed in node is also red (default color)
+        if (parent->color == RED && grandparent == nullptr) {
+            parent->color = BLACK; //switch root color
+            RBT_STAT(statistics.recolors++);
+            return;
+        }
+
+        //direction now becomes the parent's direction relative to the grandparent (to get uncle and check for inner and outer children)
+
+        //dir = (parent == grandparent->right) ? right : left; //direction of parent (this was working, changed to function for ease of use)
+        dir = nodeDirection(parent);
+        uncle = grandparent->child(1 - dir); //opposite parent direction
+
+        //Case 5: If parent is red but uncle is black, then parent would have a red child (but we can't just swap colors like in case 2)
+        if (getColor(uncle) == BLACK && parent->color == RED) {
+            //Check if inner child
+            if (node == parent->child(1 - dir)) {
+                rotateSubTree(parent, dir);
+                //rotate parent to grandparent position (dir is the direction parent is in relative to grandparent).
+
+                //update the node names (since we use pointers, the one at the top should be the parent now)
+                node = parent;
+                parent = grandparent->child(dir);
+            }
+
+            //Case 6 (will come after case 5 since this is what fixes requirement 3, since parent and node could both be red after doing case 5)
+            rotateSubTree(grandparent, static_cast<direction>(1 - dir));
+            //rotate opposite direction at grandparent (parent is now grandparent)
+            parent->color = BLACK;
+            grandparent->color = RED;
+            RBT_STAT(statistics.recolors += 2);
+            return;
+        }
+
+
+        //case 2: If both uncle and parent are red then requirement 4 would be violated when inserting a new node
+        if (uncle != nullptr && (parent->color == RED && uncle->color == RED)) {
+            parent->color = BLACK;
+            uncle->color = BLACK;
+            grandparent->color = RED; //this may violate rule 3 if grandparent's parent is red
+            RBT_STAT(statistics.recolors += 3);
+            node = grandparent; //sets node to grandparent so we can continue checking validity upwards through the tree
+
+            //grandparent = node->parent->parent;
+        }
+    }
+    while ((parent = node->parent)); //loop while parent is not null (and go up the tree)
+
+    //case 3 (if case 2 has happened enough for height to increase) then every requirement is met (we can basically exit function)
+
+    root->color = BLACK; //make sure root is black
+}
+
+//remove traversal (add some memory cleanup)
+RBT_TEMPLATE
+void RBT_CLASS::remove(Node* toRemove) {
+    if (toRemove == nullptr) return;
+    RBT_STAT(const StatTimer timer(statistics.removeLatency, statistics.timing));
+    settleLive();
+    if constexpr (multiset) {
+        copyCount--;
+        if (--toRemove->value.count > 0) {
+            return; //other copies are left, the node stays
+        }
+    }
+
+    //keep the cached ends of the tree up to date
+    if (toRemove == first) {
+        first = successor(toRemove);
+    }
+    if (toRemove == last) {
+        last = predecessor(toRemove);
+    }
+    nodeCount--;
+
+    [[maybe_unused]] const Node* changed = detach(toRemove);
+    pool.destroy(toRemove); //free up memory (goes back to the pool)
+    RBT_STAT(statistics.frees++);
+#if RBT_CHECK_PATHS
+    checkPath(changed);
+#endif
+}
+
+RBT_TEMPLATE
+bool RBT_CLASS::erase(const Key& key) {
+    Node* pos = root;
+    while (pos != nullptr) {
+        if (less(key, pos->data)) {
+            pos = pos->left;
+        } else if (less(pos->data, key)) {
+            pos = pos->right;
+        } else {
+            remove(pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::erase_range(const Key& lo, const Key& hi) {
+    if (less(hi, lo)) {
+        return 0;
+    }
+    //nothing in range is the common case for small ranges, so check it before restructuring anything
+    const Node* firstErased = lower_bound(lo).current;
+    if (firstErased == nullptr || less(hi, firstErased->data)) {
+        return 0;
+    }
+
+    settleLive();
+    const std::size_t before = nodeCount;
+    const SplitRoots below = splitRoots(root, blackHeight(root), lo);
+    const SplitRoots above = splitRoots(below.upper, below.upperHeight, hi);
+    root = nullptr;
+    for (Node* bound : {below.found, above.found}) {
+        if (bound != nullptr) {
+            pool.destroy(bound);
+            RBT_STAT(statistics.frees++);
+            nodeCount--;
+        }
+    }
+    deleteSubtree(above.lower); //everything strictly between lo and hi
+
+    int height;
+    root = join2Roots(below.lower, below.lowerHeight, above.upper, above.upperHeight, height);
+    if (root != nullptr) {
+        root->color = BLACK;
+    }
+    //first only moves if nothing was left below lo, and last only if nothing was left above hi
+    first = below.lower != nullptr ? first : (root != nullptr ? tree_min(root) : nullptr);
+    last = above.upper != nullptr ? last : (root != nullptr ? tree_max(root) : nullptr);
+    copiesKnown = false; //the erased subtrees weren't walked, so their copies weren't counted
+    return before - nodeCount;
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::detach(Node* toRemove) -> Node* {
+    Node* x = nullptr; // Replacement node
+    Node* y = nullptr; // In order successor
+    Node* xParent = nullptr; // Parent of replacement node
+    direction xDir = left; // Side of xParent that x ends up on (x may be null, so it can't be asked)
+    Color originalColor = toRemove->color;
+
+    // Case 1: node to remove has at one child (swap with it's only child)
+    if (toRemove->left == nullptr || toRemove->right == nullptr) {
+        if (toRemove->left != nullptr) {
+            //if it has left child
+            x = toRemove->left;
+        } else {
+            //if it has right child (or no children)
+            x = toRemove->right;
+        }
+        xParent = toRemove->parent;
+        if (xParent != nullptr) {
+            xDir = nodeDirection(toRemove);
+        }
+
+        // Replace toRemove with its child
+        transplant(toRemove, x);
+
+        if (x != nullptr) {
+             x->color = BLACK; //switch color to black (switching color to red should never happen).
+             RBT_STAT(statistics.recolors++);
+        }
+    }
+    // Case 2: has two children (replace with in order successor)
+    else {
+        // Find the in order successor (minimum of right subtree)
+        y = tree_min(toRemove->right);
+        originalColor = y->color;
+        x = y->right;
+
+        //if the successor is a direct child, track it as the parent of x (since y will become the node to be removed).
+        if (y->parent == toRemove) {
+            //if the successor is a direct child
+            xParent = y;
+            xDir = right;
+            if (x != nullptr)
+                x->parent = y;
+        } else {
+
+            //if the successor is not the direct child, remove it from its position and put it as the right subtree of the node being removed.
+            xParent = y->parent; //update xParent, since y will be the node to be replaced by x now.
+            xDir = left; //the successor is the leftmost node of the right subtree, so it was a left child
+            transplant(y, y->right); //replace y with its right child
+            y->right = toRemove->right; //y's right child is now the toRemove node's right.
+            if (y->right != nullptr) {
+                //update the right of y subtree (the nodes following y)
+                y->right->parent = y;
+            }
+        }
+
+        // Finally, Replace toRemove with y
+        transplant(toRemove, y);
+        y->left = toRemove->left;
+        if (y->left != nullptr)
+            y->left->parent = y; //update the left of y subtree (the nodes before y)
+        y->color = toRemove->color;
+
+        if (x != nullptr && originalColor == BLACK) { //special case. where the in order successor has a non null right child
+            //a black successor with one child means that child is red, so making it black puts the missing black back
+            x->color = BLACK;
+            RBT_STAT(statistics.recolors++);
+        }
+    }
+
+    //everything from the lowest node that lost a descendant up to the root has a smaller subtree now
+    if constexpr (augmented) {
+        refreshUp(xParent);
+    }
+
+    // Fix Red-Black properties if removed a black node
+    //(if x exists it was red and has been made black above, and if there is no parent the tree is now empty)
+    if (originalColor == BLACK && x == nullptr && xParent != nullptr) {
+        //a black leaf went away, so xParent's xDir side (now null) is one black node short
+        removeBalance(xParent, xDir);
+    }
+    return xParent;
+}
+
+//The subtree at parent->child(dir) has one less black node on every path than its sibling's
+RBT_TEMPLATE
+void RBT_CLASS::removeBalance(Node* parent, direction dir) {
+    /* Loop Follows:
+       -At the start of each iteration the short subtree is parent's dir child (null in the first iteration, since a leaf was removed)
+       -The number of black nodes on tree paths through the short subtree is one less than before deletion, but this is unchanged for other paths. This means parent has a violation of requirement 4.
+       -The sibling can't be null: its side has at least one more black node than the short side
+    */
+    //case 1: (parent is null) the short subtree is the whole tree, so every path lost a black node and the tree is balanced
+    while (parent != nullptr) {
+        RBT_STAT(statistics.removeFixups++);
+        Node* sibling = parent->child(1 - dir);
+
+        //Case 3: (sibling is red, so nephews and parent must be black). This rotates the tree so that it can be fixed in cases 4,5, or 6
+        if (sibling->color == RED) {
+            //(if node is left of parent rotate left, if it's right, do the opposite)
+            rotateSubTree(parent, dir); //rotate so that the sibling becomes the new parent (or node's grandparent now)
+            parent->color = RED;
+            sibling->color = BLACK;
+            RBT_STAT(statistics.recolors += 2);
+            sibling = parent->child(1 - dir); //the old close nephew is the sibling now (and it's black)
+        }
+
+        Node* close_nephew = sibling->child(dir); //close = same direction
+        Node* far_nephew = sibling->child(1 - dir); //far = opposite direction as node is to it's parent
+
+        if (getColor(close_nephew) == BLACK && getColor(far_nephew) == BLACK) {
+            sibling->color = RED;
+            RBT_STAT(statistics.recolors++);
+
+            //Case 4: Sibling and it's children are black, but parent is red
+            if (parent->color == RED) {
+                //switching the colors will add one to the # of black nodes through the short path (since it's parent will now be black), which makes up for the deleted black nodes without altering the # of black nodes through sibling's path.
+                parent->color = BLACK;
+                RBT_STAT(statistics.recolors++);
+                return; //after case 4 the tree should be balanced
+            }
+
+            //case 2: (if parent, sibling, and sibling's children are black) taking a black off the sibling's side makes
+            //the whole parent subtree one short, so move up the tree
+            const Node* current = parent;
+            parent = parent->parent;
+            if (parent != nullptr) {
+                dir = nodeDirection(current);
+            }
+            continue;
+        }
+
+        //Case 5: Sibling is black, the close child is red, the far child is black.
+        if (getColor(far_nephew) == BLACK) {
+            //Rotate sibling opposite of node's direction (relative to parent). Now the close child takes sibling's place.
+            rotateSubTree(sibling, static_cast<direction>(1 - dir));
+
+            //Swap the close child and sibling's colors and update pointer positions
+            sibling->color = RED;
+            close_nephew->color = BLACK;
+            RBT_STAT(statistics.recolors += 2);
+            far_nephew = sibling; //sibling would now be in the position of node's far nephew
+            sibling = close_nephew; //close_nephew is now the actual sibling
+        }
+        //Now case 5 would move to case 6 to fix the tree
+
+        //Case 6: sibling is black, and it's far child (node's far nephew) is red
+        rotateSubTree(parent, dir); //rotate parent so that the sibling is now in its original position
+
+        //swap the parent and sibling colors (only happens if parent would be red)
+        sibling->color = parent->color;
+        parent->color = BLACK;
+        far_nephew->color = BLACK; //set the far_nephew color to black
+        RBT_STAT(statistics.recolors += 3);
+
+        //Now the subtree still has a root of the same color so requirement 3 is held.
+        //The tree paths not passing through the short side also pass through the same number of black nodes as before, but the short side now has an extra black ancestor (since parent was shifted to black, or sibling is added as a black grandparent). This means that paths passing through it have an additional black node, which fixes requirement 4 from being violated.
+        return; //exit loop as the tree should now be balanced after case 6
+    }
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::print(const Node* pos, const int depth, const bool isRight) {
+    //the exporter's text format is this layout, written through a buffer instead of an endl per node
+    TreeExporter<Node, Compare>(std::cout, ExportOptions<Key>{}, compare).run(pos, static_cast<std::size_t>(depth), isRight);
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::exportTree(std::ostream& out, const ExportOptions<Key>& options) const {
+    return TreeExporter<Node, Compare>(out, options, compare).run(root);
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::getNode(Node* pos, const Key& data) const -> Node* {
+    while (pos != nullptr) {
+        //if data is greater than node then go right
+        if (less(pos->data, data)) {
+            pos = pos->right;
+        } else if (less(data, pos->data)) {
+            //If data is less than the node go left
+            pos = pos->left;
+        } else {
+            return pos; //neither is less, so this is the node
+        }
+    }
+    return nullptr;
+}
+
+
+RBT_TEMPLATE
+TreeViolation RBT_CLASS::checkNode(const Node* node) const {
+    //compare is called directly, so validation doesn't count comparisons (and can run on several threads)
+    for (const Node* child : {node->left, node->right}) {
+        if (child == nullptr) {
+            continue;
+        }
+        if (child->parent != node) {
+            return TreeViolation::BrokenParentLink;
+        }
+        if (node->color == RED && child->color == RED) {
+            return TreeViolation::RedRed;
+        }
+    }
+    if ((node->left != nullptr && !compare(node->left->data, node->data)) ||
+        (node->right != nullptr && !compare(node->data, node->right->data))) {
+        return TreeViolation::OutOfOrder;
+    }
+    if constexpr (OrderStatisticAugment<Augment>) {
+        if (node->aug.size != 1 + Augment::sizeOf(node->left) + Augment::sizeOf(node->right)) {
+            return TreeViolation::WrongSubtreeSize;
+        }
+    }
+    if constexpr (IntervalAugment<Augment>) {
+        const auto& expected = Augment::subtreeMaxEnd(node);
+        if (node->aug.maxEnd < expected || expected < node->aug.maxEnd) {
+            return TreeViolation::WrongMaxEnd;
+        }
+    }
+    return TreeViolation::None;
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::validateSubtree(const ValidationFrame start, const int expectedBlacks, std::atomic<bool>& stop,
+                                ValidationReport<Node>& report, std::vector<ValidationFrame>* cut,
+                                const std::size_t cutDepth) const {
+    std::vector<ValidationFrame> stack{start};
+    while (!stack.empty()) {
+        const ValidationFrame frame = stack.back();
+        stack.pop_back();
+
+        //a null child ends a path, which has to have as many black nodes as every other path
+        if (frame.node == nullptr) {
+            if (frame.blacks != expectedBlacks) {
+                report.violation = TreeViolation::BlackHeight;
+                report.node = frame.parent;
+                stop.store(true, std::memory_order_relaxed);
+                return;
+            }
+            continue;
+        }
+        if (cut != nullptr && frame.depth == cutDepth) {
+            cut->push_back(frame);
+            continue;
+        }
+        //checking the flag on every node would make every thread share its cache line
+        if ((report.nodeCount & 1023) == 0 && stop.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const Node* node = frame.node;
+        report.nodeCount++;
+        report.maxDepth = std::max(report.maxDepth, frame.depth);
+        TreeViolation violation = checkNode(node);
+        if (violation == TreeViolation::None && ((frame.lower != nullptr && !compare(*frame.lower, node->data)) ||
+                                                 (frame.upper != nullptr && !compare(node->data, *frame.upper)))) {
+            violation = TreeViolation::OutOfOrder; //in order with its parent, but not with an ancestor further up
+        }
+        if (violation != TreeViolation::None) {
+            report.violation = violation;
+            report.node = node;
+            stop.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        const int blacks = frame.blacks + (node->color == BLACK ? 1 : 0);
+        stack.push_back({node->right, node, &node->data, frame.upper, frame.depth + 1, blacks});
+        stack.push_back({node->left, node, frame.lower, &node->data, frame.depth + 1, blacks});
+    }
+}
+
+RBT_TEMPLATE
+auto RBT_CLASS::validate(ThreadPool* pool) const -> ValidationReport<Node> {
+    ValidationReport<Node> report;
+    if (root == nullptr) {
+        if (countKnown && nodeCount != 0) {
+            report.violation = TreeViolation::WrongCount;
+        } else if (first != nullptr || last != nullptr) {
+            report.violation = TreeViolation::WrongEnds;
+        }
+        return report;
+    }
+    if (root->parent != nullptr) {
+        report.violation = TreeViolation::BrokenParentLink;
+        report.node = root;
+        return report;
+    }
+    if (root->color != BLACK) {
+        report.violation = TreeViolation::RootNotBlack;
+        report.node = root;
+        return report;
+    }
+
+    //every path has to match the leftmost one
+    const int expectedBlacks = blackHeight(root);
+    std::atomic<bool> stop{false};
+    const ValidationFrame top{root, nullptr, nullptr, nullptr, 1, 0};
+    if (pool == nullptr || pool->size() < 2 || nodeCount < parallelValidateSize) {
+        validateSubtree(top, expectedBlacks, stop, report, nullptr, 0);
+    } else {
+        //check the top levels here, and hand the subtrees under them out (about four per thread, since they differ in size)
+        const std::size_t cutDepth = 1 + std::bit_width(pool->size() * 4);
+        std::vector<ValidationFrame> subtrees;
+        validateSubtree(top, expectedBlacks, stop, report, &subtrees, cutDepth);
+        if (report.valid()) {
+            std::vector<ValidationReport<Node>> parts(subtrees.size());
+            std::vector<std::future<void>> tasks;
+            tasks.reserve(subtrees.size());
+            for (std::size_t i = 0; i < subtrees.size(); i++) {
+                tasks.push_back(pool->submit([this, &subtrees, &parts, &stop, expectedBlacks, i] {
+                    validateSubtree(subtrees[i], expectedBlacks, stop, parts[i], nullptr, 0);
+                }));
+            }
+            for (std::future<void>& task : tasks) {
+                task.get();
+            }
+            for (const ValidationReport<Node>& part : parts) {
+                report.nodeCount += part.nodeCount;
+                report.maxDepth = std::max(report.maxDepth, part.maxDepth);
+                if (report.valid() && !part.valid()) {
+                    report.violation = part.violation;
+                    report.node = part.node;
+                }
+            }
+        }
+    }
+    if (!report.valid()) {
+        return report;
+    }
+
+    if (countKnown && report.nodeCount != nodeCount) {
+        report.violation = TreeViolation::WrongCount;
+    } else if (first != tree_min(root) || last != tree_max(root)) {
+        report.violation = TreeViolation::WrongEnds;
+    } else {
+        report.blackHeight = expectedBlacks;
+    }
+    return report;
+}
+
+RBT_TEMPLATE
+bool RBT_CLASS::checkTree() const {
+    if (root == nullptr) {
+        std::cout << "Tree is empty" << std::endl;
+        return validate().valid();
+    }
+
+    const ValidationReport<Node> report = validate();
+    if (report.valid()) {
+        std::cout << "Tree passes RBT validation with black height: " << report.blackHeight << std::endl;
+        return true;
+    }
+    std::cout << "Tree is invalid: " << treeViolationMessage(report.violation);
+    if constexpr (requires(std::ostream& out, const Key& key) { out << key; }) {
+        if (report.node != nullptr) {
+            std::cout << " (at node " << report.node->data << ")";
+        }
+    }
+    std::cout << std::endl;
+    return false;
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::checkPath(const Node* node) const {
+    TreeViolation violation = TreeViolation::None;
+    const Node* pos = node != nullptr ? node : root;
+    for (; pos != nullptr; pos = pos->parent) {
+        violation = checkNode(pos);
+        //only the leftmost path of each side is counted, which keeps it O(log n) per node
+        if (violation == TreeViolation::None && blackHeight(pos->left) != blackHeight(pos->right)) {
+            violation = TreeViolation::BlackHeight;
+        }
+        if (violation == TreeViolation::None && pos->parent == nullptr) {
+            if (pos != root) {
+                violation = TreeViolation::BrokenParentLink; //climbed out of the tree
+            } else if (root->color != BLACK) {
+                violation = TreeViolation::RootNotBlack;
+            }
+        }
+        if (violation != TreeViolation::None) {
+            break;
+        }
+    }
+    if (violation != TreeViolation::None) {
+        std::cerr << "Red black tree broken by an update: " << treeViolationMessage(violation) << std::endl;
+        std::abort();
+    }
+}
+
+
+// Helper method to recursively delete nodes
+RBT_TEMPLATE
+void RBT_CLASS::deleteSubtree(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+
+    // First delete both subtrees
+    deleteSubtree(node->left);
+    deleteSubtree(node->right);
+
+    // Then delete the node itself
+    pool.destroy(node);
+    RBT_STAT(statistics.frees++);
+    nodeCount--;
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::clear() {
+    settleLive();
+    deleteSubtree(root);
+    root = nullptr;
+    first = nullptr;
+    last = nullptr;
+    nodeCount = 0;
+    countKnown = true;
+    liveKnown = true;
+    copyCount = 0;
+    copiesKnown = true;
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::settleLive() {
+    if (!liveKnown) {
+        pool.setLive(size());
+        liveKnown = true;
+    }
+}
+
+RBT_TEMPLATE
+const TreeStats& RBT_CLASS::stats() const {
+#if RBT_STATS
+    return statistics;
+#else
+    static const TreeStats none;
+    return none;
+#endif
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::resetStats() {
+#if RBT_STATS
+    const bool timing = statistics.timing;
+    statistics = TreeStats{};
+    statistics.timing = timing;
+#endif
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::setLatencyTiming([[maybe_unused]] const bool on) {
+    RBT_STAT(statistics.timing = on);
+}
+
+//Only a split (on a tree without SubtreeSize) loses the count, since it can't tell how many nodes went each way
+RBT_TEMPLATE
+std::size_t RBT_CLASS::size() const {
+    if (!countKnown) {
+        nodeCount = 0;
+        for (Node* pos = first; pos != nullptr; pos = successor(pos)) {
+            nodeCount++;
+        }
+        countKnown = true;
+    }
+    return nodeCount;
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::count(const Key& key) const {
+    const Node* pos = root;
+    while (pos != nullptr) {
+        if (less(key, pos->data)) {
+            pos = pos->left;
+        } else if (less(pos->data, key)) {
+            pos = pos->right;
+        } else if constexpr (multiset) {
+            return pos->value.count;
+        } else {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::total_count() const {
+    if constexpr (!multiset) {
+        return size();
+    } else {
+        if (!copiesKnown) {
+            copyCount = 0;
+            for (Node* pos = first; pos != nullptr; pos = successor(pos)) {
+                copyCount += pos->value.count;
+            }
+            copiesKnown = true;
+        }
+        return copyCount;
+    }
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::reserve(const std::size_t count) {
+    pool.reserve(count);
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::bytesInUse() const {
+    return liveKnown ? pool.bytesInUse() : pool.bytesFor(size());
+}
+
+RBT_TEMPLATE
+std::size_t RBT_CLASS::bytesReserved() const {
+    return pool.bytesReserved();
+}
+
+//The pool frees all of its slabs at once, so the tree only needs walking when nodes have destructors to run
+RBT_TEMPLATE
+RBT_CLASS::~BasicRedBlackTree() {
+    if constexpr (!std::is_trivially_destructible_v<Node>) {
+        deleteSubtree(root);
+    }
+}
+
+#undef RBT_TEMPLATE
+#undef RBT_CLASS
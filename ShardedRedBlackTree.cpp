@@ -0,0 +1,4 @@
+#include "ShardedRedBlackTree.h"
+
+//Compile the int version once here
+template class BasicShardedRedBlackTree<int>;
@@ -0,0 +1,142 @@
+#ifndef SHARDEDREDBLACKTREE_H
+#define SHARDEDREDBLACKTREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+#include "RedBlackTree.h"
+
+/*
+ * Thread safe set made of several BasicRedBlackTrees, each owning one slice of the key space (a shard).
+ *  -Every shard has its own reader/writer lock, so threads working on different key ranges never wait on each other.
+ *  -The shard boundaries sit behind one more reader/writer lock, striped over cache lines: normal operations take only
+ *   their thread's stripe shared, so they don't all write to one lock word; rebalance() takes every stripe exclusively
+ *   to move the boundaries.
+ *  -Each shard counts its own inserts. When one of them gets much bigger than the average (skewed keys), the insert that
+ *   notices rebalances all of them. Keys that don't start out spread (not integers) are cut up after the first few.
+ */
+template <typename Key, typename Compare = std::less<Key>>
+class BasicShardedRedBlackTree {
+public:
+    using Tree = BasicRedBlackTree<Key, EmptyValue, Compare>;
+
+    /**
+     * @brief Creates the shards. Integer keys start out split evenly over their whole range, other keys start in one
+     * shard and get split once it holds firstCutPerShard keys per shard
+     * @param shardCount Number of shards to split the keys into (at least 1)
+     */
+    explicit BasicShardedRedBlackTree(std::size_t shardCount);
+
+    BasicShardedRedBlackTree(const BasicShardedRedBlackTree&) = delete;
+    BasicShardedRedBlackTree& operator=(const BasicShardedRedBlackTree&) = delete;
+
+    /**
+     * @brief Inserts a key
+     * @return true if it was inserted, false if it was already there
+     */
+    bool insert(const Key& key);
+
+    /**
+     * @brief Removes a key
+     * @return true if it was removed, false if it wasn't there
+     */
+    bool remove(const Key& key);
+
+    /**
+     * @brief Checks if a key is in the set
+     */
+    bool contains(const Key& key) const;
+
+    /**
+     * @brief Counts every key (all shards are locked together, so the count is consistent)
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Calls fn(key) on every key in [lo, hi] in order. Every shard the range touches is read locked for the
+     * whole scan, so it sees one consistent state
+     * @param lo Smallest key to visit
+     * @param hi Largest key to visit
+     * @param fn Called with each key (must not call back into this container)
+     */
+    template <typename F>
+    void for_each_in_range(const Key& lo, const Key& hi, F&& fn) const;
+
+    /**
+     * @brief Moves the shard boundaries so every shard holds about the same number of keys (O(n), blocks everything)
+     */
+    void rebalance();
+
+    /**
+     * @brief Gets how many keys each shard holds
+     */
+    std::vector<std::size_t> shardSizes() const;
+
+    std::size_t shardCount() const { return targetShards; }
+
+private:
+    struct Shard {
+        mutable std::shared_mutex lock;
+        Tree tree;
+        std::atomic<std::size_t> count{0}; //same as tree.size(), but safe to read without the lock
+        std::size_t insertsSinceCheck = 0; //guarded by lock
+    };
+
+    //One stripe of the layout lock, on its own cache line
+    struct alignas(64) LayoutStripe {
+        mutable std::shared_mutex lock;
+    };
+
+    /**
+     * @brief Finds the shard that owns a key (layoutLock must be held)
+     */
+    std::size_t shardFor(const Key& key) const;
+
+    /**
+     * @brief Gets the stripe of the layout lock the calling thread takes shared
+     */
+    std::shared_mutex& layoutLock() const;
+
+    /**
+     * @brief Takes every stripe of the layout lock exclusively (in order, so two callers can't deadlock)
+     */
+    std::vector<std::unique_lock<std::shared_mutex>> lockLayout() const;
+
+    /**
+     * @brief Checks if the shards need rebalancing: still fewer than targetShards, or the biggest one far above average
+     * (a layout lock must be held)
+     */
+    bool isSkewed() const;
+
+    /**
+     * @brief Rebalances if isSkewed() (called by an insert that filled up its shard's check interval)
+     */
+    void maybeRebalance();
+
+    /**
+     * @brief rebalance() with the layout already locked exclusively
+     */
+    void rebalanceLocked();
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Key> boundaries; //shard i holds keys in [boundaries[i - 1], boundaries[i])
+    std::size_t targetShards;
+    [[no_unique_address]] Compare compare;
+
+    static constexpr std::size_t layoutStripes = 16;
+    LayoutStripe layoutLocks[layoutStripes];
+
+    static constexpr std::size_t checkInterval = 1 << 12; //inserts into one shard between its skew checks
+    static constexpr std::size_t firstCutPerShard = 64; //with one shard only, it's cut up once it has this many per target shard
+    static constexpr std::size_t skewFactor = 4; //a shard this many times the average triggers a rebalance
+};
+
+#include "ShardedRedBlackTree.tpp"
+
+extern template class BasicShardedRedBlackTree<int>;
+using ShardedRedBlackTree = BasicShardedRedBlackTree<int>;
+
+#endif //SHARDEDREDBLACKTREE_H
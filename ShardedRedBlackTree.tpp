@@ -0,0 +1,201 @@
+//Definitions for BasicShardedRedBlackTree (included at the bottom of ShardedRedBlackTree.h, don't include this directly)
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+#define SRBT_TEMPLATE template <typename Key, typename Compare>
+#define SRBT_CLASS BasicShardedRedBlackTree<Key, Compare>
+
+SRBT_TEMPLATE
+SRBT_CLASS::BasicShardedRedBlackTree(const std::size_t shardCount) : targetShards(std::max<std::size_t>(shardCount, 1)) {
+    if constexpr (std::is_integral_v<Key>) {
+        //spread the boundaries evenly over every possible key
+        const long double low = std::numeric_limits<Key>::min();
+        const long double high = std::numeric_limits<Key>::max();
+        for (std::size_t i = 1; i < targetShards; i++) {
+            boundaries.push_back(static_cast<Key>(low + (high - low) * i / targetShards));
+        }
+    }
+    for (std::size_t i = 0; i <= boundaries.size(); i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+SRBT_TEMPLATE
+std::size_t SRBT_CLASS::shardFor(const Key& key) const {
+    return static_cast<std::size_t>(std::upper_bound(boundaries.begin(), boundaries.end(), key, compare) - boundaries.begin());
+}
+
+SRBT_TEMPLATE
+std::shared_mutex& SRBT_CLASS::layoutLock() const {
+    //threads get stripes round robin the first time they come through, so a few threads never share one
+    static std::atomic<std::size_t> nextStripe{0};
+    thread_local const std::size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % layoutStripes;
+    return layoutLocks[stripe].lock;
+}
+
+SRBT_TEMPLATE
+auto SRBT_CLASS::lockLayout() const -> std::vector<std::unique_lock<std::shared_mutex>> {
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for (const LayoutStripe& stripe : layoutLocks) {
+        locks.emplace_back(stripe.lock);
+    }
+    return locks;
+}
+
+SRBT_TEMPLATE
+bool SRBT_CLASS::insert(const Key& key) {
+    bool inserted;
+    bool check = false;
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutLock());
+        Shard& shard = *shards[shardFor(key)];
+        std::unique_lock<std::shared_mutex> lock(shard.lock);
+        inserted = shard.tree.insert(key).second;
+        if (inserted) {
+            shard.count.fetch_add(1, std::memory_order_relaxed);
+            //the counter lives in the shard, so inserts into different shards don't touch a shared cache line
+            const std::size_t interval = shards.size() < targetShards ? targetShards * firstCutPerShard : checkInterval;
+            if (++shard.insertsSinceCheck >= interval) {
+                shard.insertsSinceCheck = 0;
+                check = true;
+            }
+        }
+    }
+    if (check) {
+        maybeRebalance();
+    }
+    return inserted;
+}
+
+SRBT_TEMPLATE
+bool SRBT_CLASS::remove(const Key& key) {
+    std::shared_lock<std::shared_mutex> layout(layoutLock());
+    Shard& shard = *shards[shardFor(key)];
+    std::unique_lock<std::shared_mutex> lock(shard.lock);
+    if (!shard.tree.erase(key)) {
+        return false;
+    }
+    shard.count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+SRBT_TEMPLATE
+bool SRBT_CLASS::contains(const Key& key) const {
+    std::shared_lock<std::shared_mutex> layout(layoutLock());
+    const Shard& shard = *shards[shardFor(key)];
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    return shard.tree.find(key) != shard.tree.end();
+}
+
+//Shard locks are always taken in shard order, so two scans (or a scan and a size) can't deadlock
+SRBT_TEMPLATE
+std::size_t SRBT_CLASS::size() const {
+    std::shared_lock<std::shared_mutex> layout(layoutLock());
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    for (const auto& shard : shards) {
+        locks.emplace_back(shard->lock);
+    }
+    std::size_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->tree.size();
+    }
+    return total;
+}
+
+SRBT_TEMPLATE
+template <typename F>
+void SRBT_CLASS::for_each_in_range(const Key& lo, const Key& hi, F&& fn) const {
+    if (compare(hi, lo)) {
+        return;
+    }
+    std::shared_lock<std::shared_mutex> layout(layoutLock());
+    const std::size_t firstShard = shardFor(lo);
+    const std::size_t lastShard = shardFor(hi);
+
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    for (std::size_t i = firstShard; i <= lastShard; i++) {
+        locks.emplace_back(shards[i]->lock);
+    }
+    for (std::size_t i = firstShard; i <= lastShard; i++) {
+        shards[i]->tree.for_each_in_range(lo, hi, [&fn](const typename Tree::Node& node) { fn(node.data); });
+    }
+}
+
+SRBT_TEMPLATE
+std::vector<std::size_t> SRBT_CLASS::shardSizes() const {
+    std::shared_lock<std::shared_mutex> layout(layoutLock());
+    std::vector<std::size_t> sizes;
+    for (const auto& shard : shards) {
+        sizes.push_back(shard->count.load(std::memory_order_relaxed));
+    }
+    return sizes;
+}
+
+SRBT_TEMPLATE
+bool SRBT_CLASS::isSkewed() const {
+    std::size_t total = 0;
+    std::size_t biggest = 0;
+    for (const auto& shard : shards) {
+        const std::size_t count = shard->count.load(std::memory_order_relaxed);
+        total += count;
+        biggest = std::max(biggest, count);
+    }
+    return shards.size() < targetShards || biggest * targetShards > skewFactor * total;
+}
+
+SRBT_TEMPLATE
+void SRBT_CLASS::maybeRebalance() {
+    {
+        std::shared_lock<std::shared_mutex> layout(layoutLock());
+        if (!isSkewed()) {
+            return;
+        }
+    }
+    const auto layout = lockLayout();
+    if (isSkewed()) {
+        rebalanceLocked(); //checked again, another insert may have rebalanced while this one waited for the lock
+    }
+}
+
+SRBT_TEMPLATE
+void SRBT_CLASS::rebalance() {
+    const auto layout = lockLayout();
+    rebalanceLocked();
+}
+
+//The shards are already in key order, so walking them one after another gives every key sorted.
+//Cutting that list into equal pieces gives the new boundaries, and each piece is bulk built into its shard.
+SRBT_TEMPLATE
+void SRBT_CLASS::rebalanceLocked() {
+    std::vector<Key> keys;
+    for (const auto& shard : shards) {
+        keys.insert(keys.end(), shard->tree.begin(), shard->tree.end());
+    }
+    if (keys.size() < targetShards) {
+        return; //not enough keys to split up
+    }
+
+    boundaries.clear();
+    std::vector<std::size_t> cuts{0};
+    for (std::size_t i = 1; i < targetShards; i++) {
+        const std::size_t cut = keys.size() * i / targetShards;
+        boundaries.push_back(keys[cut]);
+        cuts.push_back(cut);
+    }
+    cuts.push_back(keys.size());
+
+    shards.resize(targetShards);
+    for (std::size_t i = 0; i < targetShards; i++) {
+        if (!shards[i]) {
+            shards[i] = std::make_unique<Shard>();
+        }
+        shards[i]->tree.assignSorted(keys.begin() + cuts[i], keys.begin() + cuts[i + 1]);
+        shards[i]->count.store(cuts[i + 1] - cuts[i], std::memory_order_relaxed);
+        shards[i]->insertsSinceCheck = 0;
+    }
+}
+
+#undef SRBT_TEMPLATE
+#undef SRBT_CLASS
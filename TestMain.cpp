@@ -0,0 +1,8 @@
+#include <iostream>
+#include "TestRedBlackTree.h"
+
+//Runs every test without the interactive menu (this is what ctest runs)
+int main() {
+    std::cout << "Running comprehensive Red-Black Tree tests..." << std::endl;
+    return testRedBlackTree() ? 0 : 1;
+}
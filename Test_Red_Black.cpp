@@ -1,8 +1,53 @@
 #include "RedBlackTree.h"
+#include "CompactRedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+#include "PersistentRedBlackTree.h"
 #include "TestRedBlackTree.h"
+#include "ParallelLoad.h"
+#include "FastIntReader.h"
+#include "FrozenTree.h"
+#include "ThreadPool.h"
+#include "TreeJournal.h"
+#include "TreeSnapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
+//Walks the tree with its iterators and checks the keys come out sorted and match size()
+static bool checkInOrder(const RedBlackTree& tree) {
+    std::size_t count = 0;
+    bool sorted = true;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        auto next = it;
+        ++next;
+        if (next != tree.end() && !(*it < *next)) {
+            sorted = false;
+        }
+        count++;
+    }
+    if (!sorted || count != tree.size()) {
+        std::cout << "ERROR: in order walk found " << count << " keys (size is " << tree.size() << ")"
+            << (sorted ? "" : " and they are out of order") << std::endl;
+        return false;
+    }
+    return true;
+}
+
 //Tests for the important test cases.
 bool testRedBlackTree() {
     RedBlackTree tree;
@@ -103,11 +148,13 @@ bool testRedBlackTree() {
 
         // Validate the tree before removal
         std::cout << "Validating tree before removal:" << std::endl;
-        rbt->checkTree();
+        if (!rbt->checkTree()) {
+            allTestsPassed = false;
+        }
 
         // Find and remove the target value
         std::cout << "Removing value: " << test.valueToRemove << std::endl;
-        Node* nodeToRemove = RedBlackTree::getNode(rbt->root, test.valueToRemove);
+        Node* nodeToRemove = rbt->getNode(rbt->root, test.valueToRemove);
 
         if (nodeToRemove == nullptr) {
             std::cout << "ERROR: Value " << test.valueToRemove << " not found in tree!" << std::endl;
@@ -121,10 +168,12 @@ bool testRedBlackTree() {
 
             // Validate the tree after removal
             std::cout << "Validating tree after removal:" << std::endl;
-            rbt->checkTree();
+            if (!rbt->checkTree()) {
+                allTestsPassed = false;
+            }
 
             // Verify the node is actually removed
-            if (RedBlackTree::getNode(rbt->root, test.valueToRemove) != nullptr) {
+            if (rbt->getNode(rbt->root, test.valueToRemove) != nullptr) {
                 std::cout << "ERROR: Value " << test.valueToRemove << " still exists in the tree after removal!" << std::endl;
                 allTestsPassed = false;
             } else {
@@ -146,27 +195,1138 @@ bool testRedBlackTree() {
 
     std::cout << "Initial random tree:" << std::endl;
     randomTree->print(randomTree->root);
-    randomTree->checkTree();
+    if (!randomTree->checkTree()) {
+        allTestsPassed = false;
+    }
 
     // Remove values in a different order
     std::vector<int> removeOrder = {44, 32, 88, 28, 97, 21, 8, 65, 93, 17, 82, 54, 76, 29, 80};
 
     for (int val : removeOrder) {
         std::cout << "\nRemoving " << val << ":" << std::endl;
-        Node* nodeToRemove = RedBlackTree::getNode(randomTree->root, val);
+        Node* nodeToRemove = randomTree->getNode(randomTree->root, val);
 
         if (nodeToRemove != nullptr) {
             randomTree->remove(nodeToRemove);
             randomTree->print(randomTree->root);
-            randomTree->checkTree();
+            if (!randomTree->checkTree()) {
+                allTestsPassed = false;
+            }
         } else {
             std::cout << "ERROR: Value " << val << " not found in tree!" << std::endl;
             allTestsPassed = false;
         }
     }
 
+    if (!checkInOrder(*randomTree) || !randomTree->empty()) {
+        allTestsPassed = false;
+    }
+
+    // Every node should have gone back to the pool
+    if (randomTree->bytesInUse() != 0) {
+        std::cout << "ERROR: " << randomTree->bytesInUse() << " bytes still in use after removing every value!" << std::endl;
+        allTestsPassed = false;
+    }
+
     delete randomTree;
 
+    // Test the node pool (reserve up front, then make sure nodes get recycled)
+    std::cout << "\n--- Testing node pool ---" << std::endl;
+    RedBlackTree* poolTree = new RedBlackTree();
+    poolTree->reserve(1000);
+    const std::size_t reserved = poolTree->bytesReserved();
+    for (int i = 0; i < 1000; i++) {
+        poolTree->insert(poolTree->root, nullptr, i);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        poolTree->remove(poolTree->getNode(poolTree->root, i));
+    }
+    for (int i = 1000; i < 1500; i++) {
+        poolTree->insert(poolTree->root, nullptr, i);
+    }
+    std::cout << "Bytes in use: " << poolTree->bytesInUse() << ", bytes reserved: " << poolTree->bytesReserved() << std::endl;
+    if (poolTree->bytesReserved() != reserved) {
+        std::cout << "ERROR: node pool allocated again even though nodes were freed!" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!checkInOrder(*poolTree)) {
+        allTestsPassed = false;
+    }
+    delete poolTree;
+
+    // Test hinted inserts (ascending, descending, and a nearly sorted stream with duplicates)
+    std::cout << "\n--- Testing hinted insertion ---" << std::endl;
+    std::vector<std::vector<int>> streams(3);
+    for (int i = 0; i < 2000; i++) {
+        streams[0].push_back(i);
+        streams[1].push_back(2000 - i);
+        streams[2].push_back(i % 50 == 0 ? i - 25 : i / 2);
+    }
+    for (const auto& stream : streams) {
+        RedBlackTree hintTree;
+        RedBlackTree::iterator hint = hintTree.end();
+        for (int val : stream) {
+            hint = hintTree.insert(hint, val);
+            if (*hint != val) {
+                std::cout << "ERROR: hinted insert returned the wrong position for " << val << std::endl;
+                allTestsPassed = false;
+                break;
+            }
+        }
+        if (!checkInOrder(hintTree)) {
+            allTestsPassed = false;
+        }
+        if (!hintTree.checkTree()) {
+            allTestsPassed = false;
+        }
+
+        // Walking backwards from end() should visit everything too
+        std::size_t backwards = 0;
+        for (auto it = hintTree.end(); it != hintTree.begin(); --it) {
+            backwards++;
+        }
+        if (backwards != hintTree.size()) {
+            std::cout << "ERROR: reverse walk found " << backwards << " keys" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+
+    // Test a generic tree (64-bit keys, move-only values, reversed order)
+    std::cout << "\n--- Testing generic key/value tree ---" << std::endl;
+    BasicRedBlackTree<std::uint64_t, std::unique_ptr<std::string>, std::greater<>> mapTree;
+    for (std::uint64_t id = 1; id <= 100; id++) {
+        mapTree.emplace(id << 40, std::make_unique<std::string>("record " + std::to_string(id)));
+    }
+    if (mapTree.emplace(std::uint64_t(5) << 40, nullptr).second) {
+        std::cout << "ERROR: duplicate key was inserted!" << std::endl;
+        allTestsPassed = false;
+    }
+    auto* found = mapTree.getNode(mapTree.root, std::uint64_t(42) << 40);
+    if (found == nullptr || *found->value != "record 42") {
+        std::cout << "ERROR: mapped value not found!" << std::endl;
+        allTestsPassed = false;
+    }
+    if (decltype(mapTree)::tree_min(mapTree.root)->data != std::uint64_t(100) << 40) {
+        std::cout << "ERROR: comparator was not used for ordering!" << std::endl;
+        allTestsPassed = false;
+    }
+    mapTree.remove(found);
+    if (!mapTree.checkTree()) {
+        allTestsPassed = false;
+    }
+    //a comparator with state: getNode has to search with the tree's copy, not a default constructed one
+    struct ModuloLess {
+        int modulus = 0;
+        bool operator()(const int a, const int b) const { return a % modulus < b % modulus; }
+    };
+    BasicRedBlackTree<int, EmptyValue, ModuloLess> moduloTree(ModuloLess{1000});
+    for (int i = 0; i < 100; i++) {
+        moduloTree.insert(i * 37 % 1000);
+    }
+    if (moduloTree.getNode(moduloTree.root, 1074) == nullptr || moduloTree.getNode(moduloTree.root, 75) != nullptr) {
+        std::cout << "ERROR: getNode didn't search with the tree's comparator" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test bulk building from sorted input (every size up to a few full levels, so every shape of bottom level is covered)
+    std::cout << "\n--- Testing bulk build from sorted keys ---" << std::endl;
+    std::vector<int> sortedKeys;
+    RedBlackTree bulkTree;
+    for (int n = 0; n <= 130; n++) {
+        bulkTree.assignSorted(sortedKeys.begin(), sortedKeys.end());
+        if (!checkInOrder(bulkTree) || bulkTree.size() != sortedKeys.size()) {
+            allTestsPassed = false;
+        }
+        if (n == 130) {
+            if (!bulkTree.checkTree()) {
+                allTestsPassed = false;
+            }
+        }
+        sortedKeys.push_back(n * 3);
+    }
+    // The built tree should keep working with normal inserts and removes
+    for (int i = 0; i < 400; i += 2) {
+        bulkTree.insert(i);
+    }
+    for (int i = 0; i < 400; i += 5) {
+        bulkTree.remove(bulkTree.getNode(bulkTree.root, i));
+    }
+    if (!checkInOrder(bulkTree)) {
+        allTestsPassed = false;
+    }
+    if (!bulkTree.checkTree()) {
+        allTestsPassed = false;
+    }
+
+    // Test order statistics (rank/select/count_range) while inserting and removing
+    std::cout << "\n--- Testing order statistics ---" << std::endl;
+    OrderStatisticTree statTree;
+    std::vector<int> statKeys;
+    for (int i = 0; i < 3000; i++) {
+        const int key = (i * 7877) % 4001;
+        statTree.insert(key);
+        if (i % 4 == 3) {
+            const int gone = (i * 7877 / 3) % 4001;
+            statTree.remove(statTree.getNode(statTree.root, gone));
+        }
+    }
+    statKeys.assign(statTree.begin(), statTree.end());
+    for (std::size_t k = 0; k < statKeys.size(); k += 37) {
+        if (*statTree.select(k) != statKeys[k] || statTree.rank(statKeys[k]) != k || statTree.rank(statKeys[k] + 1) != k + 1) {
+            std::cout << "ERROR: rank/select disagree with the in order walk at position " << k << std::endl;
+            allTestsPassed = false;
+            break;
+        }
+    }
+    if (statTree.select(statKeys.size()) != statTree.end() || statTree.root->aug.size != statTree.size() ||
+        statTree.count_range(1000, 2000) != static_cast<std::size_t>(std::count_if(statKeys.begin(), statKeys.end(),
+            [](const int key) { return key >= 1000 && key <= 2000; }))) {
+        std::cout << "ERROR: subtree sizes are out of date" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!statTree.checkTree()) {
+        allTestsPassed = false;
+    }
+
+    // Test the bound searches and range visitor against a sorted vector
+    std::cout << "\n--- Testing bounds and range scans ---" << std::endl;
+    RedBlackTree boundTree;
+    std::vector<int> boundKeys;
+    for (int i = 0; i < 500; i++) {
+        boundKeys.push_back(i * 4 - 1000);
+    }
+    boundTree.assignSorted(boundKeys.begin(), boundKeys.end());
+    for (int key = -1010; key < 1010; key += 3) {
+        const auto lower = std::lower_bound(boundKeys.begin(), boundKeys.end(), key);
+        const auto upper = std::upper_bound(boundKeys.begin(), boundKeys.end(), key);
+        const bool lowerOk = lower == boundKeys.end() ? boundTree.lower_bound(key) == boundTree.end() : *boundTree.lower_bound(key) == *lower;
+        const bool upperOk = upper == boundKeys.end() ? boundTree.upper_bound(key) == boundTree.end() : *boundTree.upper_bound(key) == *upper;
+        const bool floorOk = upper == boundKeys.begin() ? boundTree.floor(key) == boundTree.end() : *boundTree.floor(key) == *(upper - 1);
+        const bool findOk = (boundTree.find(key) != boundTree.end()) == std::binary_search(boundKeys.begin(), boundKeys.end(), key);
+        if (!lowerOk || !upperOk || !floorOk || !findOk) {
+            std::cout << "ERROR: bound searches are wrong for " << key << std::endl;
+            allTestsPassed = false;
+            break;
+        }
+    }
+    std::vector<int> inRange;
+    boundTree.for_each_in_range(-7, 41, [&](const Node& node) { inRange.push_back(node.data); });
+    if (inRange != std::vector<int>(std::lower_bound(boundKeys.begin(), boundKeys.end(), -7),
+                                    std::upper_bound(boundKeys.begin(), boundKeys.end(), 41))) {
+        std::cout << "ERROR: for_each_in_range visited the wrong keys" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test batched inserts and removes (small batches walk from key to key, big ones rebuild) against single inserts
+    std::cout << "\n--- Testing batch insert and erase ---" << std::endl;
+    RedBlackTree batchTree;
+    RedBlackTree batchReference;
+    unsigned int batchSeed = 99;
+    for (const std::size_t batchSize : {std::size_t(3000), std::size_t(50), std::size_t(400), std::size_t(5000), std::size_t(20)}) {
+        for (const bool erasing : {false, true}) {
+            std::vector<int> batch;
+            std::size_t expectedApplied = 0;
+            for (std::size_t i = 0; i < batchSize; i++) {
+                batchSeed = batchSeed * 1103515245 + 12345;
+                batch.push_back(static_cast<int>((batchSeed >> 16) % 6000)); //repeats within the batch too
+            }
+            for (const int key : batch) {
+                if (erasing) {
+                    Node* node = batchReference.getNode(batchReference.root, key);
+                    expectedApplied += node != nullptr ? 1 : 0;
+                    batchReference.remove(node);
+                } else {
+                    expectedApplied += batchReference.insert(key).second ? 1 : 0;
+                }
+            }
+            const BatchResult result = erasing ? batchTree.erase_batch(batch) : batchTree.insert_batch(batch);
+            if (result.applied != expectedApplied || result.applied + result.skipped != batchSize ||
+                !std::equal(batchTree.begin(), batchTree.end(), batchReference.begin(), batchReference.end()) ||
+                !checkInOrder(batchTree) || batchTree.size() != batchReference.size()) {
+                std::cout << "ERROR: " << (erasing ? "erase_batch" : "insert_batch") << " of " << batchSize
+                    << " keys applied " << result.applied << ", expected " << expectedApplied << std::endl;
+                allTestsPassed = false;
+            }
+        }
+    }
+    if (!batchTree.checkTree()) {
+        allTestsPassed = false;
+    }
+
+    // Test split and join: cut a tree in pieces, change the pieces, and put them back together
+    std::cout << "\n--- Testing split and join ---" << std::endl;
+    RedBlackTree splitTree;
+    for (int i = 0; i < 3000; i++) {
+        splitTree.insert((i * 7919) % 5000);
+    }
+    std::vector<int> splitExpected(splitTree.begin(), splitTree.end());
+    const std::size_t bytesPerNode = splitTree.bytesInUse() / splitTree.size();
+    const std::size_t bytesBeforeSplit = splitTree.bytesInUse();
+    const std::size_t reservedBeforeSplit = splitTree.bytesReserved();
+    auto [olderIds, hadKey, newerIds] = splitTree.split(2500);
+    if (olderIds.bytesReserved() + newerIds.bytesReserved() != reservedBeforeSplit || newerIds.bytesReserved() == 0) {
+        std::cout << "ERROR: the halves of a split reserve " << olderIds.bytesReserved() << " + "
+            << newerIds.bytesReserved() << " bytes, expected " << reservedBeforeSplit << " between them" << std::endl;
+        allTestsPassed = false;
+    }
+    if (olderIds.bytesInUse() + newerIds.bytesInUse() + bytesPerNode != bytesBeforeSplit ||
+        newerIds.bytesInUse() != newerIds.size() * bytesPerNode) {
+        std::cout << "ERROR: the halves of a split use " << olderIds.bytesInUse() << " + " << newerIds.bytesInUse()
+            << " bytes, expected " << bytesBeforeSplit - bytesPerNode << " between them" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!splitTree.empty() || !hadKey || !checkInOrder(olderIds) || !checkInOrder(newerIds) ||
+        olderIds.size() + newerIds.size() + 1 != splitExpected.size() || *--olderIds.end() >= 2500 ||
+        *newerIds.begin() <= 2500) {
+        std::cout << "ERROR: split(2500) gave the wrong halves" << std::endl;
+        allTestsPassed = false;
+    }
+    // The halves keep working as normal trees (nodes moved, they weren't copied)
+    for (int i = 0; i < 200; i++) {
+        olderIds.insert(-1 - i);
+        newerIds.remove(newerIds.getNode(newerIds.root, 2500 + i));
+        splitExpected.push_back(-1 - i);
+        splitExpected.erase(std::remove(splitExpected.begin(), splitExpected.end(), 2500 + i), splitExpected.end());
+    }
+    if (olderIds.bytesInUse() != olderIds.size() * bytesPerNode || newerIds.bytesInUse() != newerIds.size() * bytesPerNode) {
+        std::cout << "ERROR: split halves report " << olderIds.bytesInUse() << " and " << newerIds.bytesInUse()
+            << " bytes in use after inserts and removes" << std::endl;
+        allTestsPassed = false;
+    }
+    OrderStatisticTree sizedSplitTree;
+    for (int i = 0; i < 1000; i++) {
+        sizedSplitTree.insert(i);
+    }
+    const std::size_t sizedBytesPerNode = sizedSplitTree.bytesInUse() / 1000;
+    const std::size_t sizedReserved = sizedSplitTree.bytesReserved();
+    auto [sizedLower, sizedFound, sizedUpper] = sizedSplitTree.split(500);
+    if (sizedLower.bytesReserved() + sizedUpper.bytesReserved() != sizedReserved ||
+        sizedUpper.bytesReserved() < sizedUpper.bytesInUse() || sizedLower.bytesReserved() < sizedLower.bytesInUse()) {
+        std::cout << "ERROR: order statistic split halves reserve " << sizedLower.bytesReserved() << " and "
+            << sizedUpper.bytesReserved() << " bytes" << std::endl;
+        allTestsPassed = false;
+    }
+    sizedUpper.erase(900);
+    if (sizedLower.bytesInUse() != 500 * sizedBytesPerNode || sizedUpper.bytesInUse() != 498 * sizedBytesPerNode) {
+        std::cout << "ERROR: order statistic split halves report " << sizedLower.bytesInUse() << " and "
+            << sizedUpper.bytesInUse() << " bytes in use" << std::endl;
+        allTestsPassed = false;
+    }
+    //joining keeps the unused ends of both pools' newest slabs, so the joined tree fills them before reserving more
+    RedBlackTree smallLeft;
+    RedBlackTree smallRight;
+    for (int i = 0; i < 100; i++) {
+        smallLeft.insert(i);
+        smallRight.insert(1000 + i);
+    }
+    RedBlackTree smallJoined = RedBlackTree::join2(std::move(smallLeft), std::move(smallRight));
+    const std::size_t joinedReserved = smallJoined.bytesReserved();
+    const std::size_t spareSlots = (joinedReserved - smallJoined.bytesInUse()) / bytesPerNode;
+    for (std::size_t i = 0; i < spareSlots; i++) {
+        smallJoined.insert(2000 + static_cast<int>(i));
+    }
+    if (smallJoined.bytesReserved() != joinedReserved || smallJoined.size() != 200 + spareSlots) {
+        std::cout << "ERROR: a joined tree reserved " << smallJoined.bytesReserved() - joinedReserved
+            << " more bytes while it still had " << spareSlots << " spare slots" << std::endl;
+        allTestsPassed = false;
+    }
+    RedBlackTree joinedTree = RedBlackTree::join(std::move(olderIds), 2500, std::move(newerIds));
+    std::sort(splitExpected.begin(), splitExpected.end());
+    splitExpected.insert(std::lower_bound(splitExpected.begin(), splitExpected.end(), 2500), 2500);
+    auto [beforeLast, hadLast, lastPart] = joinedTree.split(*--joinedTree.end());
+    joinedTree = RedBlackTree::join2(std::move(beforeLast), std::move(lastPart));
+    splitExpected.pop_back();
+    if (!hadLast || !std::equal(joinedTree.begin(), joinedTree.end(), splitExpected.begin(), splitExpected.end()) ||
+        joinedTree.size() != splitExpected.size()) {
+        std::cout << "ERROR: join and join2 don't give back the same keys" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!joinedTree.checkTree()) {
+        allTestsPassed = false;
+    }
+    try {
+        RedBlackTree::join(RedBlackTree(), 5, std::move(joinedTree));
+        std::cout << "ERROR: join accepted keys out of order" << std::endl;
+        allTestsPassed = false;
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Test erase by key (0 included, the old remove used a Key{} sentinel) and erase_range
+    std::cout << "\n--- Testing erase and erase_range ---" << std::endl;
+    RedBlackTree eraseTree;
+    std::vector<int> eraseExpected;
+    for (int i = -500; i <= 500; i++) {
+        eraseTree.insert(i);
+    }
+    if (!eraseTree.erase(0) || eraseTree.erase(0) || eraseTree.erase(1000) || !eraseTree.erase(-500)) {
+        std::cout << "ERROR: erase returned the wrong result" << std::endl;
+        allTestsPassed = false;
+    }
+    const std::size_t rangeRemoved = eraseTree.erase_range(-100, 99); //0 is already gone
+    const std::size_t emptyRemoved = eraseTree.erase_range(-50, 50) + eraseTree.erase_range(10, -10);
+    const std::size_t edgeRemoved = eraseTree.erase_range(400, 10000); //runs off the end, so last has to move
+    for (int i = -499; i < 400; i++) {
+        if (i < -100 || i > 99) {
+            eraseExpected.push_back(i);
+        }
+    }
+    if (rangeRemoved != 199 || emptyRemoved != 0 || edgeRemoved != 101 ||
+        !std::equal(eraseTree.begin(), eraseTree.end(), eraseExpected.begin(), eraseExpected.end()) ||
+        eraseTree.size() != eraseExpected.size() || *--eraseTree.end() != 399) {
+        std::cout << "ERROR: erase_range removed " << rangeRemoved << ", " << emptyRemoved << " and " << edgeRemoved
+            << " keys, expected 199, 0 and 101" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!eraseTree.checkTree()) {
+        allTestsPassed = false;
+    }
+    if (eraseTree.erase_range(INT_MIN, INT_MAX) != eraseExpected.size() || !eraseTree.empty() ||
+        eraseTree.begin() != eraseTree.end()) {
+        std::cout << "ERROR: erase_range over every key left something behind" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the stats counters (they only count in RBT_STATS builds, otherwise they have to stay zero)
+    std::cout << "\n--- Testing stats ---" << std::endl;
+    RedBlackTree statsTree;
+    statsTree.setLatencyTiming(true);
+    for (int i = 0; i < 1000; i++) {
+        statsTree.insert(i); //ascending keys rotate and recolor all the way
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        statsTree.remove(statsTree.find(i).node());
+    }
+    const TreeStats& treeStats = statsTree.stats();
+    if (RedBlackTree::statsEnabled) {
+        if (treeStats.allocations != 1000 || treeStats.frees != 500 || treeStats.rotations == 0 || treeStats.recolors == 0 ||
+            treeStats.insertFixups < 1000 || treeStats.removeFixups == 0 || treeStats.comparisons == 0 ||
+            treeStats.insertLatency.count != 1000 || treeStats.removeLatency.count != 500 || treeStats.findLatency.count != 500) {
+            std::cout << "ERROR: stats don't add up:" << std::endl;
+            treeStats.print(std::cout);
+            allTestsPassed = false;
+        }
+        statsTree.resetStats();
+        if (statsTree.stats().rotations != 0 || statsTree.stats().allocations != 0) {
+            std::cout << "ERROR: resetStats left counts behind" << std::endl;
+            allTestsPassed = false;
+        }
+    } else if (treeStats.rotations != 0 || treeStats.allocations != 0 || treeStats.insertLatency.count != 0) {
+        std::cout << "ERROR: stats were counted in a build without RBT_STATS" << std::endl;
+        allTestsPassed = false;
+    }
+    //lookups are const, so readers can share a tree: every comparison they make should still be counted exactly once
+    const auto lookupAll = [&statsTree] {
+        std::size_t hits = 0;
+        for (int i = 0; i < 2000; i++) {
+            hits += statsTree.find(i) != statsTree.end();
+        }
+        return hits;
+    };
+    const std::uint64_t comparisonsBefore = statsTree.stats().comparisons;
+    lookupAll();
+    const std::uint64_t comparisonsPerReader = statsTree.stats().comparisons - comparisonsBefore;
+    std::vector<std::thread> statReaders;
+    std::vector<std::size_t> statReaderHits(4);
+    for (std::size_t t = 0; t < statReaderHits.size(); t++) {
+        statReaders.emplace_back([&, t] { statReaderHits[t] = lookupAll(); });
+    }
+    for (std::thread& reader : statReaders) {
+        reader.join();
+    }
+    if (statsTree.stats().comparisons - comparisonsBefore != comparisonsPerReader * 5 ||
+        std::count(statReaderHits.begin(), statReaderHits.end(), 500) != 4) {
+        std::cout << "ERROR: concurrent readers lost comparison counts" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test batched lookups (more keys than the lookup window, with hits and misses mixed)
+    std::cout << "\n--- Testing batched lookups ---" << std::endl;
+    RedBlackTree lookupTree;
+    for (int i = 0; i < 3000; i++) {
+        lookupTree.insert(i * 37 % 6007);
+    }
+    std::vector<int> lookupKeys;
+    for (int i = 0; i < 2000; i++) {
+        lookupKeys.push_back(i * 3 - 50);
+    }
+    std::vector<RedBlackTree::iterator> lookupResults(lookupKeys.size());
+    const std::unique_ptr<bool[]> lookupFound(new bool[lookupKeys.size()]);
+    lookupTree.find_batch(lookupKeys, lookupResults);
+    std::size_t batchFound = lookupTree.contains_batch(lookupKeys, std::span<bool>(lookupFound.get(), lookupKeys.size()));
+    std::size_t loopFound = 0;
+    for (std::size_t i = 0; i < lookupKeys.size(); i++) {
+        const RedBlackTree::iterator expected = lookupTree.find(lookupKeys[i]);
+        loopFound += expected != lookupTree.end() ? 1 : 0;
+        if (lookupResults[i] != expected || lookupFound[i] != (expected != lookupTree.end())) {
+            std::cout << "ERROR: batched lookup of " << lookupKeys[i] << " disagrees with find" << std::endl;
+            allTestsPassed = false;
+            break;
+        }
+    }
+    if (batchFound != loopFound) {
+        std::cout << "ERROR: contains_batch found " << batchFound << " keys, expected " << loopFound << std::endl;
+        allTestsPassed = false;
+    }
+    try {
+        lookupTree.find_batch(lookupKeys, std::span<RedBlackTree::iterator>(lookupResults.data(), 10));
+        std::cout << "ERROR: find_batch accepted a results buffer that was too short" << std::endl;
+        allTestsPassed = false;
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Test the frozen (Eytzinger layout) snapshot against the tree's own lower_bound, for every size up to a few levels
+    std::cout << "\n--- Testing frozen snapshots ---" << std::endl;
+    FrozenTree frozen;
+    for (int keyCount = 0; keyCount <= 70; keyCount++) {
+        RedBlackTree source;
+        for (int i = 0; i < keyCount; i++) {
+            source.insert(i * 2 + 1); //odd keys, so every even probe falls in a gap
+        }
+        frozen.assign(source.begin(), source.size()); //reuses the memory from the last size
+        for (int probe = -1; probe <= keyCount * 2 + 1; probe++) {
+            const RedBlackTree::iterator expected = source.lower_bound(probe);
+            const int* found = frozen.lower_bound(probe);
+            if ((expected == source.end()) != (found == nullptr) || (found != nullptr && *found != *expected) ||
+                frozen.contains(probe) != (source.find(probe) != source.end())) {
+                std::cout << "ERROR: frozen snapshot of " << keyCount << " keys got lower_bound(" << probe << ") wrong"
+                    << std::endl;
+                allTestsPassed = false;
+                break;
+            }
+        }
+    }
+    RedBlackTree liveTree;
+    for (int i = 0; i < 5000; i++) {
+        liveTree.insert(i * 7 % 5003);
+    }
+    const FrozenTree frozenBefore = liveTree.freeze();
+    liveTree.remove(liveTree.getNode(liveTree.root, 7));
+    if (!frozenBefore.contains(7) || frozenBefore.size() != 5000 || liveTree.freeze().contains(7)) {
+        std::cout << "ERROR: a frozen snapshot changed with the tree, or a new one missed the change" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test union, intersection and difference (big enough that the pool gets subtrees to run in parallel)
+    std::cout << "\n--- Testing set operations ---" << std::endl;
+    ThreadPool setPool(3);
+    std::vector<int> setKeysA;
+    std::vector<int> setKeysB;
+    for (int i = 0; i < 40000; i++) {
+        setKeysA.push_back(i * 3);
+        setKeysB.push_back(i * 5 + 1000);
+    }
+    for (int operation = 0; operation < 3; operation++) {
+        RedBlackTree setA;
+        RedBlackTree setB;
+        setA.assignSorted(setKeysA.begin(), setKeysA.end());
+        for (const int key : setKeysB) {
+            setB.insert(key); //built the slow way so its shape differs from setA's
+        }
+        std::vector<int> expected;
+        RedBlackTree combined;
+        if (operation == 0) {
+            std::set_union(setKeysA.begin(), setKeysA.end(), setKeysB.begin(), setKeysB.end(), std::back_inserter(expected));
+            combined = RedBlackTree::set_union(std::move(setA), std::move(setB), &setPool);
+        } else if (operation == 1) {
+            std::set_intersection(setKeysA.begin(), setKeysA.end(), setKeysB.begin(), setKeysB.end(), std::back_inserter(expected));
+            combined = RedBlackTree::set_intersection(std::move(setA), std::move(setB), &setPool);
+        } else {
+            std::set_difference(setKeysA.begin(), setKeysA.end(), setKeysB.begin(), setKeysB.end(), std::back_inserter(expected));
+            combined = RedBlackTree::set_difference(std::move(setA), std::move(setB), nullptr);
+        }
+        if (!std::equal(combined.begin(), combined.end(), expected.begin(), expected.end()) ||
+            combined.size() != expected.size() || !setA.empty() || !setB.empty()) {
+            std::cout << "ERROR: set operation " << operation << " gave " << combined.size() << " keys, expected "
+                << expected.size() << std::endl;
+            allTestsPassed = false;
+        }
+        if (!combined.checkTree()) {
+            allTestsPassed = false;
+        }
+    }
+
+    // Test the compact (index linked) tree against the pointer tree with the same operations
+    std::cout << "\n--- Testing compact tree ---" << std::endl;
+    CompactRedBlackTree compactTree;
+    RedBlackTree referenceTree;
+    unsigned int seed = 12345;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int key = static_cast<int>((seed >> 16) % 3000);
+        if (seed % 3 == 0) {
+            const bool removed = compactTree.remove(key);
+            Node* node = referenceTree.getNode(referenceTree.root, key);
+            if (removed != (node != nullptr)) {
+                std::cout << "ERROR: compact tree remove(" << key << ") disagrees with the pointer tree" << std::endl;
+                allTestsPassed = false;
+            }
+            referenceTree.remove(node);
+        } else if (compactTree.insert(key) != referenceTree.insert(key).second) {
+            std::cout << "ERROR: compact tree insert(" << key << ") disagrees with the pointer tree" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+    std::vector<int> compactKeys;
+    compactTree.forEach([&](const int key) { compactKeys.push_back(key); });
+    if (!compactTree.checkTree() || compactKeys != std::vector<int>(referenceTree.begin(), referenceTree.end())) {
+        std::cout << "ERROR: compact tree doesn't match the pointer tree" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the sharded tree from several threads at once, with skewed keys so it has to rebalance
+    std::cout << "\n--- Testing sharded concurrent tree ---" << std::endl;
+    ShardedRedBlackTree shardedTree(8);
+    std::atomic<int> writersLeft{4};
+    std::atomic<bool> readersOk{true};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&shardedTree, &writersLeft, t] {
+            for (int i = 0; i < 20000; i++) {
+                shardedTree.insert(i * 4 + t); //all small keys, so they start out in one shard
+                if (i % 10 == 0) {
+                    shardedTree.remove(i / 2 * 4 + t); //only keys this thread inserted, so the result is deterministic
+                }
+            }
+            writersLeft--;
+        });
+    }
+    //readers share the shard locks with each other while the writers keep inserting and rebalancing
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&shardedTree, &writersLeft, &readersOk, r] {
+            int probe = r;
+            while (writersLeft > 0) {
+                shardedTree.contains(probe);
+                probe = (probe + 7919) % 80000;
+                const std::size_t total = shardedTree.size();
+                std::vector<int> window;
+                shardedTree.for_each_in_range(probe, probe + 2000, [&](const int key) { window.push_back(key); });
+                if (total > 80000 || window.size() > 2001 || !std::is_sorted(window.begin(), window.end()) ||
+                    (!window.empty() && (window.front() < probe || window.back() > probe + 2000))) {
+                    readersOk = false;
+                }
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    std::set<int> shardReference;
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 20000; i++) {
+            shardReference.insert(i * 4 + t);
+            if (i % 10 == 0) {
+                shardReference.erase(i / 2 * 4 + t);
+            }
+        }
+    }
+    std::vector<int> shardedKeys;
+    shardedTree.for_each_in_range(INT_MIN, INT_MAX, [&](const int key) { shardedKeys.push_back(key); });
+    const std::vector<std::size_t> shardSizes = shardedTree.shardSizes();
+    const std::size_t biggestShard = *std::max_element(shardSizes.begin(), shardSizes.end());
+    //every key starts in one shard, so without rebalancing it would hold them all. A shard can still be up to 4x the
+    //average at its last skew check, plus the inserts into it since (at most 1 << 12), depending on how the threads interleave
+    const std::size_t shardLimit = shardedKeys.size() * 4 / 8 + (1 << 12);
+    if (!readersOk || shardedTree.size() != shardReference.size() ||
+        !std::equal(shardedKeys.begin(), shardedKeys.end(), shardReference.begin(), shardReference.end()) ||
+        !shardedTree.contains(79999) || shardedTree.contains(0) || biggestShard > shardLimit) {
+        std::cout << "ERROR: sharded tree holds " << shardedKeys.size() << " keys (expected " << shardReference.size()
+            << "), biggest shard " << biggestShard << (readersOk ? "" : ", and a reader saw a broken state") << std::endl;
+        allTestsPassed = false;
+    }
+    //keys that can't be spread out up front start in one shard, and get cut up after the first few hundred
+    BasicShardedRedBlackTree<double> doubleShards(8);
+    for (int i = 0; i < 8 * 64; i++) {
+        doubleShards.insert(i * 0.5);
+    }
+    const std::vector<std::size_t> doubleSizes = doubleShards.shardSizes();
+    if (doubleSizes.size() != 8 || *std::min_element(doubleSizes.begin(), doubleSizes.end()) != 64) {
+        std::cout << "ERROR: " << doubleSizes.size() << " shards after the first " << 8 * 64 << " double keys" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the persistent tree: old snapshots must keep their keys while the live tree changes
+    std::cout << "\n--- Testing persistent tree snapshots ---" << std::endl;
+    PersistentRedBlackTree persistentTree;
+    RedBlackTree persistentReference;
+    std::vector<PersistentRedBlackTree::Snapshot> snapshots;
+    std::vector<std::vector<int>> snapshotKeys;
+    seed = 777;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int key = static_cast<int>((seed >> 16) % 3000);
+        if (seed % 3 == 0) {
+            Node* node = persistentReference.getNode(persistentReference.root, key);
+            if (persistentTree.remove(key) != (node != nullptr)) {
+                std::cout << "ERROR: persistent tree remove(" << key << ") disagrees with the pointer tree" << std::endl;
+                allTestsPassed = false;
+            }
+            persistentReference.remove(node);
+        } else if (persistentTree.insert(key) != persistentReference.insert(key).second) {
+            std::cout << "ERROR: persistent tree insert(" << key << ") disagrees with the pointer tree" << std::endl;
+            allTestsPassed = false;
+        }
+        if (i % 2000 == 0) {
+            snapshots.push_back(persistentTree.snapshot());
+            snapshotKeys.emplace_back(persistentReference.begin(), persistentReference.end());
+        }
+    }
+    snapshots.push_back(persistentTree.snapshot());
+    snapshotKeys.emplace_back(persistentReference.begin(), persistentReference.end());
+    for (std::size_t i = 0; i < snapshots.size(); i++) {
+        std::vector<int> keys;
+        snapshots[i].for_each([&](const int key) { keys.push_back(key); });
+        if (!snapshots[i].isValid() || keys != snapshotKeys[i] || snapshots[i].size() != keys.size()) {
+            std::cout << "ERROR: persistent snapshot " << i << " changed or isn't a valid Red-Black tree" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+
+    //a comparator with state: snapshots have to search and check the order with the tree's copy
+    BasicPersistentRedBlackTree<int, ModuloLess> moduloPersistent(ModuloLess{1000});
+    for (int i = 0; i < 100; i++) {
+        moduloPersistent.insert(i * 37 % 1000);
+    }
+    const auto moduloSnapshot = moduloPersistent.snapshot();
+    if (!moduloSnapshot.contains(1074) || moduloSnapshot.contains(75) || !moduloSnapshot.isValid() ||
+        !moduloPersistent.remove(2074) || moduloPersistent.size() != 99 || !moduloPersistent.snapshot().isValid()) {
+        std::cout << "ERROR: the persistent tree didn't use its comparator" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the integer scanner (signs, limits, overflow, junk, and runs long enough to hit the SIMD paths)
+    std::cout << "\n--- Testing integer scanner ---" << std::endl;
+    const std::string text = "-2147483648 2147483647\n2147483648 -2147483649 +5\t00000000000000000012\r\n"
+        "1-2 abc - 99999999999999999999    \n\n                      7 -0 x";
+    std::vector<int> scanned;
+    ScanResult skipped;
+    scanInts(text.data(), text.data() + text.size(), scanned, skipped);
+    const std::vector<int> expectedScan = {-2147483648, 2147483647, 5, 12, 7, 0};
+    if (scanned != expectedScan || skipped.invalid != 4 || skipped.overflow != 3) {
+        std::cout << "ERROR: scanner found " << scanned.size() << " numbers, " << skipped.invalid << " invalid, "
+            << skipped.overflow << " overflowed" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the parallel file loader (merges with what's already in the tree)
+    std::cout << "\n--- Testing parallel file load ---" << std::endl;
+    const char* loadFile = "parallel_load_test.txt";
+    {
+        std::ofstream out(loadFile);
+        for (int i = 5000; i > 0; i--) {
+            out << (i * 7919) % 10007 - 5000 << (i % 10 == 0 ? "\n" : " ");
+        }
+        out << "oops 20000 20000";
+    }
+    RedBlackTree loadTree;
+    loadTree.insert(100000);
+    ThreadPool loadPool(3);
+    LoadTimings timings;
+    if (!parallelLoadFile(loadTree, loadFile, loadPool, timings) || timings.parsed != 5002 || timings.invalid != 1 ||
+        loadTree.size() != 5002 || !checkInOrder(loadTree)) {
+        std::cout << "ERROR: parallel load read " << timings.parsed << " numbers into " << loadTree.size() << " nodes" << std::endl;
+        allTestsPassed = false;
+    }
+    if (!loadTree.checkTree()) {
+        allTestsPassed = false;
+    }
+    std::remove(loadFile);
+
+    // Test binary snapshots (round trip, then a flipped byte and a cut off file have to be refused)
+    std::cout << "\n--- Testing binary snapshots ---" << std::endl;
+    const char* snapshotFile = "snapshot_test.bin";
+    RedBlackTree savedTree;
+    for (int i = 0; i < 3000; i++) {
+        savedTree.insert((i * 7919) % 10007 - 5000);
+    }
+    RedBlackTree loadedTree;
+    loadedTree.insert(123456); //loading replaces what was there
+    const SnapshotStatus saveStatus = saveSnapshot(savedTree, snapshotFile);
+    const SnapshotStatus loadStatus = loadSnapshot(loadedTree, snapshotFile);
+    if (saveStatus != SnapshotStatus::Ok || loadStatus != SnapshotStatus::Ok || loadedTree.size() != savedTree.size() ||
+        !std::equal(loadedTree.begin(), loadedTree.end(), savedTree.begin(), savedTree.end())) {
+        std::cout << "ERROR: snapshot round trip failed: " << snapshotStatusMessage(saveStatus) << ", "
+            << snapshotStatusMessage(loadStatus) << std::endl;
+        allTestsPassed = false;
+    }
+    if (!loadedTree.checkTree()) {
+        allTestsPassed = false;
+    }
+    {
+        std::fstream corrupt(snapshotFile, std::ios::in | std::ios::out | std::ios::binary);
+        corrupt.seekp(sizeof(SnapshotHeader) + 100);
+        corrupt.put('\x7F');
+    }
+    const SnapshotStatus corruptStatus = loadSnapshot(loadedTree, snapshotFile);
+    {
+        std::ofstream truncated(snapshotFile, std::ios::binary | std::ios::trunc);
+        truncated.write("RBTSNAP", 8);
+    }
+    const SnapshotStatus truncatedStatus = loadSnapshot(loadedTree, snapshotFile);
+    if (corruptStatus != SnapshotStatus::ChecksumMismatch || truncatedStatus != SnapshotStatus::NotASnapshot ||
+        loadedTree.size() != savedTree.size()) {
+        std::cout << "ERROR: a damaged snapshot was not refused: " << snapshotStatusMessage(corruptStatus) << ", "
+            << snapshotStatusMessage(truncatedStatus) << std::endl;
+        allTestsPassed = false;
+    }
+    //a checksum over keys that are out of order (or repeated) still has to be refused, and so does version 0
+    const int unorderedKeys[] = {1, 5, 3};
+    const int repeatedKeys[] = {1, 2, 2};
+    saveSnapshot(unorderedKeys, 3, snapshotFile);
+    const SnapshotStatus unorderedStatus = loadSnapshot(loadedTree, snapshotFile);
+    saveSnapshot(repeatedKeys, 3, snapshotFile);
+    const SnapshotStatus repeatedStatus = loadSnapshot(loadedTree, snapshotFile);
+    {
+        std::fstream versionless(snapshotFile, std::ios::in | std::ios::out | std::ios::binary);
+        versionless.seekp(offsetof(SnapshotHeader, version));
+        const std::uint32_t zero = 0;
+        versionless.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+    }
+    const SnapshotStatus versionStatus = loadSnapshot(loadedTree, snapshotFile);
+    if (unorderedStatus != SnapshotStatus::Corrupt || repeatedStatus != SnapshotStatus::Corrupt ||
+        versionStatus != SnapshotStatus::UnsupportedVersion || loadedTree.size() != savedTree.size()) {
+        std::cout << "ERROR: a snapshot with bad keys or version 0 was not refused: " << snapshotStatusMessage(unorderedStatus)
+            << ", " << snapshotStatusMessage(repeatedStatus) << ", " << snapshotStatusMessage(versionStatus) << std::endl;
+        allTestsPassed = false;
+    }
+    std::remove(snapshotFile);
+
+    // Test the validator (a valid tree on one thread and on a pool, then one corruption of each kind has to be caught)
+    std::cout << "\n--- Testing the validator ---" << std::endl;
+    RedBlackTree validatedTree;
+    for (int i = 0; i < 100000; i++) {
+        validatedTree.insert(static_cast<int>(i * 48271LL % 100003));
+    }
+    ThreadPool validatePool(4);
+    const auto serialReport = validatedTree.validate();
+    const auto parallelReport = validatedTree.validate(&validatePool);
+    if (!serialReport.valid() || !parallelReport.valid() || serialReport.nodeCount != validatedTree.size() ||
+        parallelReport.nodeCount != validatedTree.size() || parallelReport.maxDepth != serialReport.maxDepth ||
+        parallelReport.blackHeight != serialReport.blackHeight || serialReport.maxDepth > 34) {
+        std::cout << "ERROR: validating a valid tree gave " << treeViolationMessage(serialReport.violation) << " / "
+            << treeViolationMessage(parallelReport.violation) << ", " << serialReport.nodeCount << " / "
+            << parallelReport.nodeCount << " nodes, depth " << serialReport.maxDepth << std::endl;
+        allTestsPassed = false;
+    }
+    //each corruption is undone before the next one
+    Node* middleNode = validatedTree.find(50000).node();
+    Node* redNode = nullptr;
+    for (auto it = validatedTree.find(60000); it != validatedTree.end() && redNode == nullptr; ++it) {
+        redNode = it.node()->color == RED ? it.node() : nullptr;
+    }
+    Node* leafNode = validatedTree.find(70000).node();
+    while (leafNode->left != nullptr) {
+        leafNode = leafNode->left;
+    }
+    Node* leafParent = leafNode->parent;
+    const std::function<void()> corruptions[][2] = {
+        {[&] { middleNode->data = 99999; }, [&] { middleNode->data = 50000; }},
+        {[&] { redNode->color = BLACK; }, [&] { redNode->color = RED; }},
+        {[&] { leafNode->parent = validatedTree.root; }, [&] { leafNode->parent = leafParent; }},
+    };
+    const TreeViolation expectedViolations[] = {TreeViolation::OutOfOrder, TreeViolation::BlackHeight,
+                                                TreeViolation::BrokenParentLink};
+    for (std::size_t i = 0; i < std::size(expectedViolations); i++) {
+        corruptions[i][0]();
+        const auto brokenSerial = validatedTree.validate();
+        const auto brokenParallel = validatedTree.validate(&validatePool);
+        corruptions[i][1]();
+        if (brokenSerial.violation != expectedViolations[i] || brokenParallel.violation != expectedViolations[i]) {
+            std::cout << "ERROR: expected \"" << treeViolationMessage(expectedViolations[i]) << "\" but got \""
+                << treeViolationMessage(brokenSerial.violation) << "\" / \""
+                << treeViolationMessage(brokenParallel.violation) << "\"" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+    if (!validatedTree.validate(&validatePool).valid()) {
+        std::cout << "ERROR: the tree is still broken after undoing the corruptions" << std::endl;
+        allTestsPassed = false;
+    }
+    OrderStatisticTree sizedTree;
+    for (int i = 0; i < 1000; i++) {
+        sizedTree.insert(i);
+    }
+    sizedTree.root->left->aug.size++;
+    if (sizedTree.validate().violation != TreeViolation::WrongSubtreeSize) {
+        std::cout << "ERROR: a wrong subtree size wasn't caught" << std::endl;
+        allTestsPassed = false;
+    }
+    sizedTree.root->left->aug.size--;
+
+    // Test tree export (every format writes every node, and the depth and key range limits cut it down)
+    std::cout << "\n--- Testing tree export ---" << std::endl;
+    RedBlackTree exportedTree;
+    for (int i = 0; i < 1000; i++) {
+        exportedTree.insert(i);
+    }
+    const auto countOf = [](const std::string& text, const std::string& pattern) {
+        std::size_t count = 0;
+        for (std::size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+            count++;
+        }
+        return count;
+    };
+    std::ostringstream textOut, dotOut, jsonOut;
+    const std::size_t textWritten = exportedTree.exportTree(textOut);
+    const std::size_t dotWritten = exportedTree.exportTree(dotOut, {ExportFormat::Dot});
+    const std::size_t jsonWritten = exportedTree.exportTree(jsonOut, {ExportFormat::Json});
+    if (textWritten != 1000 || dotWritten != 1000 || jsonWritten != 1000 || countOf(textOut.str(), "\n") != 1000 ||
+        countOf(dotOut.str(), "[label=") != 1000 || countOf(dotOut.str(), " -> ") != 999 ||
+        countOf(jsonOut.str(), "{\"id\":") != 1000 || countOf(jsonOut.str(), "\"parent\":null") != 1) {
+        std::cout << "ERROR: a full export didn't write every node (" << textWritten << ", " << dotWritten << ", "
+            << jsonWritten << ")" << std::endl;
+        allTestsPassed = false;
+    }
+    ExportOptions<int> limited;
+    limited.maxDepth = 3;
+    std::ostringstream shallowOut;
+    if (exportedTree.exportTree(shallowOut, limited) != 15 || countOf(shallowOut.str(), "...") != 16) {
+        std::cout << "ERROR: a depth limited export didn't stop at the top 4 levels" << std::endl;
+        allTestsPassed = false;
+    }
+    limited = ExportOptions<int>{ExportFormat::Text, SIZE_MAX, 100, 199};
+    std::ostringstream rangeOut;
+    std::size_t rangeWritten = exportedTree.exportTree(rangeOut, limited);
+    std::istringstream rangeLines(rangeOut.str());
+    std::string rangeLine;
+    int expectedKey = 199; //the text format puts the biggest keys on top
+    bool rangeInOrder = true;
+    while (std::getline(rangeLines, rangeLine)) {
+        const std::size_t start = rangeLine.find_first_not_of(" ΓL");
+        rangeInOrder = rangeInOrder && std::stoi(rangeLine.substr(start)) == expectedKey--;
+    }
+    for (const ExportFormat format : {ExportFormat::Dot, ExportFormat::Json}) {
+        limited.format = format;
+        std::ostringstream ignored;
+        rangeWritten += exportedTree.exportTree(ignored, limited);
+    }
+    if (rangeWritten != 300 || !rangeInOrder || expectedKey != 99) {
+        std::cout << "ERROR: a key range export wrote " << rangeWritten << " nodes over 3 formats, expected 300"
+            << std::endl;
+        allTestsPassed = false;
+    }
+    BasicRedBlackTree<std::string> namedTree;
+    namedTree.insert("say \"hi\"");
+    std::ostringstream namedOut;
+    namedTree.exportTree(namedOut, {ExportFormat::Json});
+    if (namedOut.str().find("\"key\":\"say \\\"hi\\\"\"") == std::string::npos) {
+        std::cout << "ERROR: string keys aren't escaped in JSON: " << namedOut.str() << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test multisets (repeats are counted in place, removes count down before the node goes)
+    std::cout << "\n--- Testing multisets ---" << std::endl;
+    RedBlackMultiset multiset;
+    for (int i = 0; i < 100; i++) {
+        multiset.insert(i);
+    }
+    const std::size_t distinctBytes = multiset.bytesInUse();
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 100; i += 2) {
+            multiset.insert(i); //even keys end up with 5 copies
+        }
+    }
+    if (multiset.size() != 100 || multiset.total_count() != 300 || multiset.count(10) != 5 || multiset.count(11) != 1 ||
+        multiset.count(100) != 0 || multiset.bytesInUse() != distinctBytes) {
+        std::cout << "ERROR: repeated multiset inserts should only add to the counts (size " << multiset.size()
+            << ", total " << multiset.total_count() << ", count(10) " << multiset.count(10) << ")" << std::endl;
+        allTestsPassed = false;
+    }
+    for (int i = 0; i < 4; i++) {
+        multiset.erase(10);
+    }
+    if (multiset.count(10) != 1 || multiset.size() != 100 || multiset.total_count() != 296) {
+        std::cout << "ERROR: erasing a copy should count a multiset key down" << std::endl;
+        allTestsPassed = false;
+    }
+    multiset.erase(10);
+    if (multiset.count(10) != 0 || multiset.size() != 99 || multiset.total_count() != 295 ||
+        !multiset.validate().valid()) {
+        std::cout << "ERROR: erasing the last copy should remove the node" << std::endl;
+        allTestsPassed = false;
+    }
+    const int repeats[] = {20, 20, 21, 500};
+    multiset.insert_batch(repeats);
+    if (multiset.count(20) != 7 || multiset.count(21) != 2 || multiset.count(500) != 1 || multiset.total_count() != 299) {
+        std::cout << "ERROR: a multiset batch should count every repeat" << std::endl;
+        allTestsPassed = false;
+    }
+    multiset.erase_range(0, 49); //24 even keys with 5 copies (20 has 7) and 25 odd keys (21 has 2)
+    if (multiset.size() != 51 || multiset.total_count() != 299 - 122 - 26) {
+        std::cout << "ERROR: total_count() is " << multiset.total_count() << " after erase_range" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test interval trees (overlap and stabbing queries match a linear scan while inserts and removes rotate the tree)
+    std::cout << "\n--- Testing interval trees ---" << std::endl;
+    IntervalTree intervals;
+    std::vector<Interval<int>> intervalList;
+    for (int i = 0; i < 2000; i++) {
+        const int start = static_cast<int>(i * 7919LL % 10007);
+        const Interval<int> interval{start, start + static_cast<int>(i * 104729LL % 300)};
+        if (intervals.insert(interval).second) {
+            intervalList.push_back(interval);
+        }
+    }
+    for (std::size_t i = 0; i < intervalList.size(); i += 3) {
+        intervals.erase(intervalList[i]);
+    }
+    std::erase_if(intervalList, [&](const Interval<int>& interval) { return intervals.count(interval) == 0; });
+    const auto intervalQueryMatches = [&](const int lo, const int hi) {
+        std::vector<Interval<int>> found;
+        const std::size_t visited = intervals.overlapping(lo, hi, [&](const Interval<int>& interval) {
+            found.push_back(interval);
+        });
+        std::vector<Interval<int>> expected;
+        std::copy_if(intervalList.begin(), intervalList.end(), std::back_inserter(expected),
+                     [&](const Interval<int>& interval) { return interval.overlaps(lo, hi); });
+        std::sort(expected.begin(), expected.end());
+        return visited == found.size() && found == expected;
+    };
+    bool intervalQueriesMatch = intervals.validate().valid();
+    for (int lo = -100; lo < 10500 && intervalQueriesMatch; lo += 97) {
+        intervalQueriesMatch = intervalQueryMatches(lo, lo) && intervalQueryMatches(lo, lo + 40) &&
+            intervalQueryMatches(lo, lo + 1000);
+    }
+    if (!intervalQueriesMatch || !intervalQueryMatches(5, 4) || intervals.size() != intervalList.size()) {
+        std::cout << "ERROR: interval queries don't match a linear scan" << std::endl;
+        allTestsPassed = false;
+    }
+    std::size_t stabbed = 0;
+    const std::size_t stabCount = intervals.stabbing(5000, [&](const Interval<int>& interval) {
+        stabbed += interval.start <= 5000 && 5000 <= interval.end;
+        return stabbed < 2; //stop after the second one
+    });
+    if (stabCount != 2 || stabbed != 2) {
+        std::cout << "ERROR: a stabbing query didn't stop when the visitor returned false" << std::endl;
+        allTestsPassed = false;
+    }
+    auto [earlyIntervals, splitInterval, lateIntervals] = intervals.split(intervalList[100]);
+    if (!earlyIntervals.validate().valid() || !lateIntervals.validate().valid() || !splitInterval) {
+        std::cout << "ERROR: splitting an interval tree left a wrong largest end point" << std::endl;
+        allTestsPassed = false;
+    }
+    lateIntervals.root->aug.maxEnd++;
+    if (lateIntervals.validate().violation != TreeViolation::WrongMaxEnd) {
+        std::cout << "ERROR: the validator missed a wrong largest end point" << std::endl;
+        allTestsPassed = false;
+    }
+
+    // Test the journal (updates come back after a restart, a torn last record is dropped, compaction folds segments away)
+    std::cout << "\n--- Testing the journal ---" << std::endl;
+    const std::string journalBase = "journal_test";
+    std::set<int> journaledKeys;
+    {
+        RedBlackTree journaledTree;
+        journaledTree.insert(99999); //opening a journal with nothing saved under its path starts from an empty tree
+        TreeJournal writer(JournalOptions{std::chrono::milliseconds(1), 256});
+        JournalRecovery recovery;
+        if (!writer.open(journaledTree, journalBase, recovery) || !journaledTree.empty() || recovery.segments != 0) {
+            std::cout << "ERROR: a new journal didn't start empty" << std::endl;
+            allTestsPassed = false;
+        }
+        for (int i = 0; i < 1000; i++) {
+            journaledTree.insert(i * 3);
+            writer.recordInsert(i * 3);
+            journaledKeys.insert(i * 3);
+        }
+        for (int i = 0; i < 300; i += 2) {
+            journaledTree.erase(i);
+            writer.recordRemove(i);
+            journaledKeys.erase(i);
+        }
+        if (!writer.sync()) {
+            std::cout << "ERROR: journal sync failed" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+    {
+        RedBlackTree recoveredTree;
+        TreeJournal reader;
+        JournalRecovery recovery;
+        const bool opened = reader.open(recoveredTree, journalBase, recovery);
+        if (!opened || recovery.records != 1150 || recovery.segments != 1 || recovery.tornSegments != 0 ||
+            !std::equal(recoveredTree.begin(), recoveredTree.end(), journaledKeys.begin(), journaledKeys.end())) {
+            std::cout << "ERROR: journal replay gave " << recoveredTree.size() << " keys from " << recovery.records
+                << " records, expected " << journaledKeys.size() << " from 1150" << std::endl;
+            allTestsPassed = false;
+        }
+        if (!recoveredTree.checkTree()) {
+            allTestsPassed = false;
+        }
+        const std::vector<int> more = {-1, -2, -3};
+        recoveredTree.insert_batch(more);
+        reader.recordInserts(more);
+        journaledKeys.insert(more.begin(), more.end());
+        if (reader.waitForCompaction() != SnapshotStatus::Ok || std::ifstream(journalBase + ".wal.1").good()) {
+            std::cout << "ERROR: compaction didn't replace the replayed segment with a snapshot" << std::endl;
+            allTestsPassed = false;
+        }
+    }
+    {
+        std::ofstream torn(journalBase + ".wal.2", std::ios::binary | std::ios::app);
+        torn.write("\x01\x05\x00\x00", 4); //a record cut off part way
+    }
+    {
+        RedBlackTree recoveredTree;
+        TreeJournal reader;
+        JournalRecovery recovery;
+        reader.open(recoveredTree, journalBase, recovery);
+        if (recovery.snapshot != SnapshotStatus::Ok || recovery.records != 3 || recovery.tornSegments != 1 ||
+            !std::equal(recoveredTree.begin(), recoveredTree.end(), journaledKeys.begin(), journaledKeys.end())) {
+            std::cout << "ERROR: recovery over a torn segment gave " << recoveredTree.size() << " keys, expected "
+                << journaledKeys.size() << std::endl;
+            allTestsPassed = false;
+        }
+    }
+    for (const char* suffix : {".snap", ".wal.1", ".wal.2", ".wal.3"}) {
+        std::remove((journalBase + suffix).c_str());
+    }
+
+#ifdef __linux__
+    //writes that fail (files pointed at /dev/full) are reported by the calls the program makes, not dropped quietly
+    {
+        const std::string failingBase = "journal_fail_test";
+        RedBlackTree failingTree;
+        TreeJournal failing;
+        JournalRecovery recovery;
+        if (!failing.open(failingTree, failingBase, recovery)) {
+            std::cout << "ERROR: couldn't open a journal for the failed write test" << std::endl;
+            allTestsPassed = false;
+        }
+        failingTree.insert(7);
+        failing.recordInsert(7);
+
+        std::filesystem::create_symlink("/dev/full", failingBase + ".wal.2");
+        std::ostringstream segmentOut;
+        if (compactJournal(failing, failingTree, segmentOut) ||
+            segmentOut.str().find("new segment couldn't be created") == std::string::npos) {
+            std::cout << "ERROR: a segment that couldn't be written wasn't reported: " << segmentOut.str() << std::endl;
+            allTestsPassed = false;
+        }
+        std::ostringstream syncOut;
+        if (!syncJournal(failing, syncOut) || !syncOut.str().empty()) {
+            std::cout << "ERROR: the journal stopped working after a failed compaction" << std::endl;
+            allTestsPassed = false;
+        }
+
+        std::filesystem::create_symlink("/dev/full", failingBase + ".snap.tmp");
+        std::ostringstream snapshotOut;
+        compactJournal(failing, failingTree, snapshotOut); //the snapshot is written in the background
+        if (closeJournal(failing, snapshotOut) ||
+            snapshotOut.str().find(snapshotStatusMessage(SnapshotStatus::WriteFailed)) == std::string::npos) {
+            std::cout << "ERROR: a snapshot that couldn't be written wasn't reported: " << snapshotOut.str() << std::endl;
+            allTestsPassed = false;
+        }
+        for (const char* suffix : {".snap", ".snap.tmp", ".wal.1", ".wal.2", ".wal.3"}) {
+            std::remove((failingBase + suffix).c_str());
+        }
+    }
+#endif
+
     if (allTestsPassed) {
         std::cout << "\n=== All Red-Black Tree tests PASSED! ===" << std::endl;
     } else {
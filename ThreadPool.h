@@ -0,0 +1,201 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Fixed size pool of worker threads with work stealing.
+ *  -Every worker has its own task deque. Tasks submitted from a worker go on the back of its own deque and it takes
+ *   them back from there (newest first, so nested divide and conquer stays depth first and cache warm).
+ *  -A worker that runs out steals from the front of the other deques (the oldest, usually biggest, tasks).
+ *  -Tasks submitted from outside the pool go on one extra shared deque.
+ * submit() hands back a future, so callers can wait on (and get exceptions from) each task. invoke() runs two tasks
+ * fork/join style, and the waiting thread keeps running queued tasks instead of blocking, so tasks can nest.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads
+     * @param threadCount Number of workers (0 means one per hardware thread)
+     */
+    explicit ThreadPool(std::size_t threadCount = 0) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i <= threadCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>()); //the last one is for submitters outside the pool
+        }
+        workers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Queues a task to run on one of the workers
+     * @param task Callable with no arguments
+     * @return Future for the task's result
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& task) {
+        using Result = std::invoke_result_t<F>;
+        //packaged_task is move only but std::function needs copies, so it lives behind a shared_ptr
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        push([packaged] { (*packaged)(); });
+        return result;
+    }
+
+    /**
+     * @brief Runs two tasks, possibly at the same time, and returns once both are done. first runs on the calling
+     * thread while second is queued for anyone to steal; if nobody has by then, the caller runs it too
+     * @param first Callable with no arguments
+     * @param second Callable with no arguments
+     * @throws Whatever either task threw (first's exception wins if both did)
+     */
+    template <typename A, typename B>
+    void invoke(A&& first, B&& second) {
+        std::future<void> other = submit(std::forward<B>(second));
+        try {
+            first();
+        } catch (...) {
+            wait(other); //second may still be using the caller's stack
+            throw;
+        }
+        wait(other);
+        other.get();
+    }
+
+    /**
+     * @brief Waits for a future, running queued tasks in the meantime (so a task can wait on tasks it queued)
+     * @param result Future of a task in this pool
+     */
+    template <typename T>
+    void wait(const std::future<T>& result) {
+        while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * @brief Runs one queued task on the calling thread, if there is one
+     * @return true if a task was run
+     */
+    bool runPendingTask() {
+        std::function<void()> task;
+        if (!takeTask(currentPool == this ? currentIndex : workers.size(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    std::size_t size() const { return workers.size(); } //number of worker threads
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task) {
+        {
+            //counted first (so queued never drops below the real count) and under sleepLock, so a worker can't check
+            //for work and go to sleep in between
+            std::lock_guard<std::mutex> lock(sleepLock);
+            queued++;
+        }
+        WorkQueue& queue = *queues[currentPool == this ? currentIndex : workers.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    //Own queue from the back, then everyone else's (and the shared one) from the front
+    bool takeTask(const std::size_t own, std::function<void()>& task) {
+        if (queued.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        {
+            WorkQueue& queue = *queues[own];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            WorkQueue& queue = *queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(const std::size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        while (true) {
+            std::function<void()> task;
+            if (takeTask(index, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepLock);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return; //stopping and nothing left to do
+            }
+        }
+    }
+
+    static inline thread_local ThreadPool* currentPool = nullptr; //pool the calling thread works for (if any)
+    static inline thread_local std::size_t currentIndex = 0; //its queue in that pool
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues; //one per worker, plus one shared
+    std::atomic<std::size_t> queued{0}; //tasks in every queue combined
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif //THREADPOOL_H
@@ -0,0 +1,313 @@
+#ifndef TREEEXPORT_H
+#define TREEEXPORT_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+enum class ExportFormat {
+    Text, //the indented layout print() has always used (right subtree on top)
+    Dot, //Graphviz (dot -Tsvg tree.dot -o tree.svg)
+    Json //{"nodes":[...]} with one flat object per node, so it streams (and parses) without deep nesting
+};
+
+/*
+ * What to export. Limits are applied while walking, so a small part of a huge tree only costs the nodes on the way
+ * to it: subtrees under the depth limit aren't visited, and neither are subtrees entirely outside the key range.
+ * A node left out by the range is skipped but its children in range are still written, attached to the closest
+ * ancestor that was written (dashed edges in DOT, "skipped":true in JSON).
+ */
+template <typename Key>
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Text;
+    std::size_t maxDepth = std::numeric_limits<std::size_t>::max(); //deepest level written (the root is level 0)
+    std::optional<Key> lower{}; //only keys >= lower are written
+    std::optional<Key> upper{}; //only keys <= upper are written
+};
+
+
+//Collects output in one big block and hands it to the stream when it's full, so there's no per node write or flush
+class ExportBuffer {
+public:
+    static constexpr std::size_t defaultCapacity = 1 << 20;
+
+    explicit ExportBuffer(std::ostream& out, const std::size_t capacity = defaultCapacity) : out(out), capacity(capacity) {
+        buffer.reserve(capacity);
+    }
+
+    ExportBuffer(const ExportBuffer&) = delete;
+    ExportBuffer& operator=(const ExportBuffer&) = delete;
+
+    ~ExportBuffer() {
+        flush();
+    }
+
+    void append(const std::string_view text) {
+        if (buffer.size() + text.size() > capacity) {
+            flush();
+        }
+        buffer.append(text);
+    }
+
+    void append(const char c) {
+        if (buffer.size() == capacity) {
+            flush();
+        }
+        buffer.push_back(c);
+    }
+
+    void append(const std::size_t count, const char c) {
+        if (buffer.size() + count > capacity) {
+            flush();
+        }
+        buffer.append(count, c);
+    }
+
+    template <typename T>
+    void appendNumber(const T value) {
+        char digits[64];
+        const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        append(std::string_view(digits, end - digits));
+    }
+
+    /**
+     * @brief Appends text inside double quotes, escaped for JSON (or for a DOT label, which only needs " and \)
+     */
+    void appendQuoted(const std::string_view text, const bool json) {
+        append('"');
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                append('\\');
+                append(c);
+            } else if (json && static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                append(escaped);
+            } else {
+                append(c);
+            }
+        }
+        append('"');
+    }
+
+    /**
+     * @brief Writes what's buffered to the stream (one write call, no flush of the stream itself)
+     */
+    void flush() {
+        if (!buffer.empty()) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+private:
+    std::ostream& out;
+    std::string buffer;
+    std::size_t capacity;
+};
+
+
+/*
+ * Writes a subtree in one of the ExportFormats. Works on any node with data, left, right and color (and any key that
+ * is a number, converts to a string_view, or can be written to an ostream).
+ */
+template <typename Node, typename Compare>
+class TreeExporter {
+public:
+    using Key = std::remove_cvref_t<decltype(std::declval<Node&>().data)>;
+
+    TreeExporter(std::ostream& out, const ExportOptions<Key>& options, const Compare& compare)
+        : buffer(out), options(options), compare(compare) {
+    }
+
+    /**
+     * @brief Writes a subtree
+     * @param root The subtree
+     * @param depth Indentation of root (text only, print() uses it to continue part way down a tree)
+     * @param isRight Whether root is a right child (text only)
+     * @return Number of nodes written
+     */
+    std::size_t run(const Node* root, const std::size_t depth = 0, const bool isRight = false) {
+        startDepth = depth;
+        switch (options.format) {
+        case ExportFormat::Text:
+            text(root, depth, isRight);
+            break;
+        case ExportFormat::Dot:
+            buffer.append("digraph RedBlackTree {\n    node [shape=circle, style=filled, fontcolor=white];\n");
+            graph(root, 0, noParent, false, false);
+            buffer.append("}\n");
+            break;
+        case ExportFormat::Json:
+            buffer.append("{\"nodes\":[");
+            graph(root, 0, noParent, false, false);
+            buffer.append("\n]}\n");
+            break;
+        }
+        buffer.flush();
+        return written;
+    }
+
+private:
+    static constexpr std::size_t noParent = std::numeric_limits<std::size_t>::max();
+
+    //the Color enum is looked up through the node, so this header doesn't need RedBlackTree.h
+    static bool isRed(const Node* node) {
+        using NodeColor = std::remove_cvref_t<decltype(node->color)>;
+        return node->color == NodeColor::RED;
+    }
+
+    bool belowRange(const Node* node) const { return options.lower && compare(node->data, *options.lower); }
+    bool aboveRange(const Node* node) const { return options.upper && compare(*options.upper, node->data); }
+
+    void text(const Node* node, const std::size_t depth, const bool isRight) {
+        if (node == nullptr) {
+            return;
+        }
+        if (depth - startDepth > options.maxDepth) {
+            indent(depth, isRight);
+            buffer.append("...\n"); //more below the depth limit
+            return;
+        }
+        //right first, so the biggest keys end up on top
+        if (!aboveRange(node)) {
+            text(node->right, depth + 1, true);
+        }
+        if (!belowRange(node) && !aboveRange(node)) {
+            indent(depth, isRight);
+            appendKeyOf(node, false, false);
+            buffer.append(isRed(node) ? " (R)\n" : " (B)\n");
+            written++;
+        }
+        if (!belowRange(node)) {
+            text(node->left, depth + 1, false);
+        }
+    }
+
+    void indent(const std::size_t depth, const bool isRight) {
+        buffer.append(depth * 4, ' ');
+        //a Γ for a right node and an L for a left node (helps show the connections of the tree better)
+        if (depth > 0) {
+            buffer.append(isRight ? "Γ " : "L ");
+        }
+    }
+
+    /**
+     * @brief Writes a node and its subtree as DOT or JSON (pre-order, so a parent is always written before its children)
+     * @param parent Id of the closest ancestor that was written (noParent for none)
+     * @param isRight Which side of that ancestor the node is on
+     * @param skipped Whether nodes outside the key range were left out between the two
+     */
+    void graph(const Node* node, const std::size_t depth, const std::size_t parent, const bool isRight, const bool skipped) {
+        if (node == nullptr || depth > options.maxDepth) {
+            return;
+        }
+        //out of range nodes aren't written, only the side that can still hold keys in range is walked
+        if (belowRange(node)) {
+            graph(node->right, depth + 1, parent, isRight, true);
+            return;
+        }
+        if (aboveRange(node)) {
+            graph(node->left, depth + 1, parent, isRight, true);
+            return;
+        }
+
+        const std::size_t id = written++;
+        const bool more = depth == options.maxDepth && (node->left != nullptr || node->right != nullptr);
+        if (options.format == ExportFormat::Dot) {
+            buffer.append("    n");
+            buffer.appendNumber(id);
+            buffer.append(" [label=");
+            appendKeyOf(node, true, false);
+            buffer.append(isRed(node) ? ", fillcolor=red];\n" : ", fillcolor=black];\n");
+            if (parent != noParent) {
+                buffer.append("    n");
+                buffer.appendNumber(parent);
+                buffer.append(" -> n");
+                buffer.appendNumber(id);
+                buffer.append(skipped ? " [style=dashed];\n" : ";\n");
+            }
+            if (more) {
+                buffer.append("    more");
+                buffer.appendNumber(id);
+                buffer.append(" [label=\"...\", shape=plaintext, style=\"\", fontcolor=black];\n    n");
+                buffer.appendNumber(id);
+                buffer.append(" -> more");
+                buffer.appendNumber(id);
+                buffer.append(";\n");
+            }
+        } else {
+            buffer.append(id == 0 ? "\n{\"id\":" : ",\n{\"id\":");
+            buffer.appendNumber(id);
+            buffer.append(",\"key\":");
+            appendKeyOf(node, true, true);
+            buffer.append(isRed(node) ? ",\"color\":\"red\",\"depth\":" : ",\"color\":\"black\",\"depth\":");
+            buffer.appendNumber(depth);
+            if (parent == noParent) {
+                buffer.append(",\"parent\":null");
+            } else {
+                buffer.append(",\"parent\":");
+                buffer.appendNumber(parent);
+                buffer.append(isRight ? ",\"side\":\"right\"" : ",\"side\":\"left\"");
+            }
+            if (skipped) {
+                buffer.append(",\"skipped\":true");
+            }
+            if (more) {
+                buffer.append(",\"more\":true");
+            }
+            buffer.append('}');
+        }
+
+        graph(node->left, depth + 1, id, false, false);
+        graph(node->right, depth + 1, id, true, false);
+    }
+
+    /**
+     * @brief Writes a node's key: numbers as they are (quoted for DOT), everything else as a string
+     * @param quoted Quote the key (numbers in JSON stay bare)
+     * @param json Escape for JSON instead of DOT
+     */
+    void appendKeyOf(const Node* node, const bool quoted, const bool json) {
+        const Key& key = node->data;
+        if constexpr (std::is_arithmetic_v<Key> && !std::is_same_v<Key, bool> && !std::is_same_v<Key, char>) {
+            if (quoted && !json) {
+                buffer.append('"');
+                buffer.appendNumber(key);
+                buffer.append('"');
+            } else {
+                buffer.appendNumber(key);
+            }
+        } else if constexpr (std::is_convertible_v<const Key&, std::string_view>) {
+            appendString(std::string_view(key), quoted, json);
+        } else {
+            std::ostringstream formatted;
+            formatted << key;
+            appendString(formatted.str(), quoted, json);
+        }
+    }
+
+    void appendString(const std::string_view text, const bool quoted, const bool json) {
+        if (quoted) {
+            buffer.appendQuoted(text, json);
+        } else {
+            buffer.append(text);
+        }
+    }
+
+    ExportBuffer buffer;
+    const ExportOptions<Key>& options;
+    const Compare& compare;
+    std::size_t written = 0;
+    std::size_t startDepth = 0;
+};
+
+#endif //TREEEXPORT_H
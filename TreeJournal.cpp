@@ -0,0 +1,373 @@
+#include "TreeJournal.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include "FastIntReader.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(JournalHeader) == 16, "the journal header is part of the file format");
+
+namespace {
+    //Forces what's been written to file onto the disk
+    bool syncFile(std::FILE* file) {
+        if (std::fflush(file) != 0) {
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    //Makes a file created (or renamed) in the directory survive a crash too
+    void syncDirectory(const std::filesystem::path& directory) {
+#ifndef _WIN32
+        const int descriptor = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+        if (descriptor >= 0) {
+            fsync(descriptor);
+            ::close(descriptor);
+        }
+#else
+        (void) directory; //NTFS journals its metadata
+#endif
+    }
+
+    std::uint32_t recordChecksum(const unsigned char* record) {
+        return static_cast<std::uint32_t>(snapshotChecksum(record, 5));
+    }
+}
+
+TreeJournal::TreeJournal(const JournalOptions options) : options(options) {
+}
+
+TreeJournal::~TreeJournal() {
+    close();
+}
+
+bool TreeJournal::open(RedBlackTree& tree, const std::string& basePath, JournalRecovery& recovery) {
+    close();
+    this->basePath = basePath;
+    recovery = JournalRecovery{};
+
+    recovery.snapshot = loadSnapshot(tree, basePath + ".snap");
+    if (recovery.snapshot == SnapshotStatus::CannotOpen) {
+        tree.clear(); //nothing saved yet
+    } else if (recovery.snapshot != SnapshotStatus::Ok) {
+        return false;
+    }
+
+    const std::vector<std::uint64_t> segments = listSegments();
+    for (const std::uint64_t segment : segments) {
+        if (!replaySegment(tree, segmentPath(segment), recovery.records)) {
+            recovery.tornSegments++;
+        }
+        recovery.segments++;
+    }
+
+    if (!openSegment(segments.empty() ? 1 : segments.back() + 1)) {
+        return false;
+    }
+    stopping = false;
+    failed = false;
+    recorded = 0;
+    durable = 0;
+    syncRequested = 0;
+    flusher = std::thread([this] { flusherLoop(); });
+
+    //fold what was replayed into the snapshot so the next start doesn't replay it again
+    if (!segments.empty()) {
+        startCompaction(std::vector<int>(tree.begin(), tree.end()), segments.back());
+    }
+    return true;
+}
+
+void TreeJournal::close() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        flushWanted.notify_one();
+        flusher.join(); //the flusher writes whatever is still pending before it stops
+    }
+    waitForCompaction();
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void TreeJournal::record(const JournalOp op, const int key) {
+    if (file == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    if (failed) {
+        return; //nothing after a failed write could be replayed in order, so it isn't kept
+    }
+    encode(op, key);
+}
+
+void TreeJournal::recordInserts(const std::span<const int> keys) {
+    if (file == nullptr || keys.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    if (failed) {
+        return;
+    }
+    pending.reserve(pending.size() + keys.size() * recordBytes);
+    for (const int key : keys) {
+        encode(JournalOp::Insert, key);
+    }
+}
+
+//Appends one record to pending (lock is held). Only the first record of a window and a full buffer wake the flusher
+void TreeJournal::encode(const JournalOp op, const int key) {
+    const bool wasEmpty = pending.empty();
+    const std::size_t offset = pending.size();
+    pending.resize(offset + recordBytes);
+    unsigned char* bytes = pending.data() + offset;
+    bytes[0] = static_cast<unsigned char>(op);
+    std::memcpy(bytes + 1, &key, sizeof(key));
+    const std::uint32_t checksum = recordChecksum(bytes);
+    std::memcpy(bytes + 5, &checksum, sizeof(checksum));
+    recorded++;
+
+    if (wasEmpty || pending.size() == options.maxPendingRecords * recordBytes) {
+        flushWanted.notify_one();
+    }
+}
+
+bool TreeJournal::sync() {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!flusher.joinable()) {
+        return !failed;
+    }
+    const std::uint64_t target = recorded;
+    if (durable < target) {
+        syncRequested = std::max(syncRequested, target);
+        flushWanted.notify_one();
+        flushed.wait(guard, [&] { return durable >= target || failed; });
+    }
+    return !failed;
+}
+
+void TreeJournal::flusherLoop() {
+    std::vector<unsigned char> batch;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        flushWanted.wait(guard, [&] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            break; //stopping, and everything is written
+        }
+        if (failed) {
+            pending.clear(); //recorded before the failure was noticed, the file can't take it any more
+            continue;
+        }
+        //let the window fill up, everything recorded until then shares one fsync
+        flushWanted.wait_for(guard, options.commitWindow, [&] {
+            return stopping || syncRequested > durable || pending.size() >= options.maxPendingRecords * recordBytes;
+        });
+
+        batch.swap(pending);
+        const std::uint64_t target = recorded;
+        guard.unlock();
+
+        bool written;
+        {
+            std::lock_guard<std::mutex> writing(writeLock);
+            written = std::fwrite(batch.data(), 1, batch.size(), file) == batch.size();
+            written = syncFile(file) && written;
+        }
+        batch.clear();
+
+        guard.lock();
+        if (!written) {
+            failed = true;
+        }
+        durable = target;
+        flushed.notify_all();
+    }
+}
+
+bool TreeJournal::compact(const RedBlackTree& tree) {
+    if (file == nullptr || !sync()) {
+        return false;
+    }
+    waitForCompaction();
+
+    const std::uint64_t lastCovered = segmentNumber;
+    {
+        std::lock_guard<std::mutex> writing(writeLock);
+        std::FILE* previous = file;
+        if (!openSegment(segmentNumber + 1)) {
+            file = previous;
+            return false;
+        }
+        std::fclose(previous);
+    }
+    startCompaction(std::vector<int>(tree.begin(), tree.end()), lastCovered);
+    return true;
+}
+
+void TreeJournal::startCompaction(std::vector<int> keys, const std::uint64_t lastCovered) {
+    compactor = std::thread([this, keys = std::move(keys), lastCovered] {
+        compactionStatus = saveSnapshot(keys.data(), keys.size(), basePath + ".snap");
+        if (compactionStatus != SnapshotStatus::Ok) {
+            return; //keep the segments, the old snapshot plus them is still the whole state
+        }
+        syncDirectory(std::filesystem::path(basePath).parent_path());
+        for (const std::uint64_t segment : listSegments()) {
+            if (segment <= lastCovered) {
+                std::remove(segmentPath(segment).c_str());
+            }
+        }
+    });
+}
+
+SnapshotStatus TreeJournal::waitForCompaction() {
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+    return compactionStatus;
+}
+
+//Creates segment number and makes it the file the flusher writes to
+bool TreeJournal::openSegment(const std::uint64_t number) {
+    const std::string path = segmentPath(number);
+    std::FILE* segment = std::fopen(path.c_str(), "wb");
+    if (segment == nullptr) {
+        return false;
+    }
+    JournalHeader header{};
+    std::memcpy(header.magic, JournalHeader::expectedMagic, sizeof(header.magic));
+    header.version = JournalHeader::currentVersion;
+    header.byteOrder = SnapshotHeader::byteOrderMark;
+    if (std::fwrite(&header, sizeof(header), 1, segment) != 1 || !syncFile(segment)) {
+        std::fclose(segment);
+        std::remove(path.c_str());
+        return false;
+    }
+    syncDirectory(std::filesystem::path(path).parent_path());
+    file = segment;
+    segmentNumber = number;
+    return true;
+}
+
+std::string TreeJournal::segmentPath(const std::uint64_t number) const {
+    return basePath + ".wal." + std::to_string(number);
+}
+
+//Numbers of the segments next to basePath, oldest first
+std::vector<std::uint64_t> TreeJournal::listSegments() const {
+    const std::filesystem::path base(basePath);
+    const std::filesystem::path directory = base.parent_path().empty() ? "." : base.parent_path();
+    const std::string prefix = base.filename().string() + ".wal.";
+
+    std::vector<std::uint64_t> segments;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        const std::string number = name.substr(prefix.size());
+        if (number.size() > 19 || !std::all_of(number.begin(), number.end(), [](const char c) { return c >= '0' && c <= '9'; })) {
+            continue; //not one of ours (e.g. a stray .tmp)
+        }
+        segments.push_back(std::stoull(number));
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+bool TreeJournal::replaySegment(RedBlackTree& tree, const std::string& path, std::size_t& records) {
+    InputBuffer input;
+    if (!input.open(path)) {
+        return false;
+    }
+    JournalHeader header;
+    if (input.size() < sizeof(header)) {
+        return false; //crashed before the header was written
+    }
+    std::memcpy(&header, input.begin(), sizeof(header));
+    if (std::memcmp(header.magic, JournalHeader::expectedMagic, sizeof(header.magic)) != 0 ||
+        header.version > JournalHeader::currentVersion || header.byteOrder != SnapshotHeader::byteOrderMark) {
+        return false;
+    }
+
+    const auto* pos = reinterpret_cast<const unsigned char*>(input.begin()) + sizeof(header);
+    const auto* end = reinterpret_cast<const unsigned char*>(input.end());
+    for (; end - pos >= static_cast<std::ptrdiff_t>(recordBytes); pos += recordBytes) {
+        int key;
+        std::uint32_t checksum;
+        std::memcpy(&key, pos + 1, sizeof(key));
+        std::memcpy(&checksum, pos + 5, sizeof(checksum));
+        if (checksum != recordChecksum(pos)) {
+            return false; //torn write, nothing after it can be trusted
+        }
+        if (pos[0] == static_cast<unsigned char>(JournalOp::Insert)) {
+            tree.insert(key);
+        } else if (pos[0] == static_cast<unsigned char>(JournalOp::Remove)) {
+            tree.erase(key);
+        } else {
+            return false;
+        }
+        records++;
+    }
+    return pos == end;
+}
+
+namespace {
+    bool reportCompaction(TreeJournal& journal, std::ostream& out) {
+        const SnapshotStatus status = journal.waitForCompaction();
+        if (status != SnapshotStatus::Ok) {
+            out << "Journal snapshot save failed: " << snapshotStatusMessage(status)
+                << " (the journal segments are kept, nothing was lost)" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+bool syncJournal(TreeJournal& journal, std::ostream& out) {
+    if (!journal.isOpen() || journal.sync()) {
+        return true;
+    }
+    out << "Journal write failed: changes from now on are only in memory (SAVE them, or open the JOURNAL again)" << std::endl;
+    return false;
+}
+
+bool compactJournal(TreeJournal& journal, const RedBlackTree& tree, std::ostream& out) {
+    if (!journal.isOpen()) {
+        return true;
+    }
+    bool ok = reportCompaction(journal, out);
+    if (!syncJournal(journal, out)) {
+        return false;
+    }
+    if (!journal.compact(tree)) {
+        out << "Journal compaction failed: a new segment couldn't be created, so this change isn't on disk (SAVE the tree)" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+bool closeJournal(TreeJournal& journal, std::ostream& out) {
+    if (!journal.isOpen()) {
+        return true;
+    }
+    bool ok = syncJournal(journal, out);
+    ok = reportCompaction(journal, out) && ok;
+    journal.close();
+    return ok;
+}
@@ -0,0 +1,183 @@
+#ifndef TREEJOURNAL_H
+#define TREEJOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RedBlackTree.h"
+#include "TreeSnapshot.h"
+
+/*
+ * Write ahead log for an int tree, so updates survive a restart without saving a snapshot after every one.
+ * Files (all next to basePath):
+ *  -basePath.snap: the last compacted state (a normal snapshot, see TreeSnapshot.h)
+ *  -basePath.wal.N: journal segments. Each is a JournalHeader followed by 9 byte records (op, key, checksum)
+ * Recovery loads the snapshot and replays every segment in order. Inserting or removing a key twice in a row does
+ * nothing the second time, so a segment that already made it into the snapshot can be replayed again safely, which is
+ * what lets compaction write the snapshot first and delete the old segments after.
+ *
+ * Group commit: recordInsert/recordRemove only append to a memory buffer. A flusher thread writes the buffer and
+ * fsyncs once per commit window (or sooner if the buffer fills up), so one fsync covers every update in the window
+ * and the tree updates at close to its in memory rate. Updates are durable once the window they were made in has been
+ * flushed, sync() waits for that.
+ */
+struct JournalHeader {
+    static constexpr char expectedMagic[8] = {'R', 'B', 'T', 'J', 'R', 'N', 'L', '\0'};
+    static constexpr std::uint32_t currentVersion = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder; //SnapshotHeader::byteOrderMark as written by the journaling machine
+};
+
+enum class JournalOp : std::uint8_t {
+    Insert = 1,
+    Remove = 2
+};
+
+//How long updates may wait before they're on disk, and how much may pile up before that
+struct JournalOptions {
+    std::chrono::milliseconds commitWindow{5}; //0 flushes as soon as the flusher wakes (roughly one fsync per update)
+    std::size_t maxPendingRecords = 1 << 16; //flush early once this many records are waiting
+};
+
+//What recovery found
+struct JournalRecovery {
+    SnapshotStatus snapshot = SnapshotStatus::Ok; //CannotOpen just means there was no snapshot yet
+    std::size_t segments = 0; //journal segments replayed
+    std::size_t records = 0; //records applied
+    std::size_t tornSegments = 0; //segments that ended in a partial or corrupt record (cut off by a crash, the rest is dropped)
+};
+
+class TreeJournal {
+public:
+    static constexpr std::size_t recordBytes = 9; //op (1 byte), key (4 bytes), low half of the checksum (4 bytes)
+
+    explicit TreeJournal(JournalOptions options = {});
+    TreeJournal(const TreeJournal&) = delete;
+    TreeJournal& operator=(const TreeJournal&) = delete;
+
+    /**
+     * @brief Flushes everything still waiting, then closes the journal (waits for a running compaction)
+     */
+    ~TreeJournal();
+
+    /**
+     * @brief Recovers the tree from basePath (snapshot + journal), then starts journaling into a new segment and
+     * compacts the recovered state in the background
+     * @param tree Replaced with the recovered contents (cleared if nothing has been saved under basePath yet)
+     * @param basePath Where the snapshot and segments live
+     * @param recovery Filled in with what was loaded
+     * @return false if the snapshot was unreadable (the tree is left alone) or a new segment couldn't be created
+     */
+    bool open(RedBlackTree& tree, const std::string& basePath, JournalRecovery& recovery);
+
+    /**
+     * @brief Flushes and closes the journal (the files stay, open() picks them up again)
+     */
+    void close();
+
+    bool isOpen() const { return file != nullptr; }
+
+    //Appends an update to the journal (call it with every update made to the tree, in the same order). Does nothing if the
+    //journal isn't open or a write has failed
+    void recordInsert(int key) { record(JournalOp::Insert, key); }
+    void recordRemove(int key) { record(JournalOp::Remove, key); }
+
+    /**
+     * @brief Records a batch of inserts under one lock (dropped the same way after a failed write)
+     */
+    void recordInserts(std::span<const int> keys);
+
+    /**
+     * @brief Waits until every update recorded so far is on disk
+     * @return false if a write or fsync failed (updates are dropped from then on, until the journal is opened again)
+     */
+    bool sync();
+
+    /**
+     * @brief Starts a new segment and writes the tree's current contents as the snapshot on a background thread,
+     * then deletes the segments it covers. Use it after changes that aren't journaled one by one (bulk loads, loading
+     * a snapshot) as well as to keep recovery short
+     * @param tree The tree (its keys are copied before this returns, so it can be changed straight away)
+     * @return false if the journal isn't open or the new segment couldn't be created
+     */
+    bool compact(const RedBlackTree& tree);
+
+    /**
+     * @brief Waits for a background compaction to finish
+     * @return Ok, or why the snapshot couldn't be written (the old snapshot and segments are kept then)
+     */
+    SnapshotStatus waitForCompaction();
+
+    /**
+     * @brief Replays one segment into a tree (stops at the first partial or corrupt record)
+     * @param tree The tree to apply the updates to
+     * @param path The segment file
+     * @param records Incremented for every record applied
+     * @return false if the file couldn't be read or isn't a journal, or the last record was torn
+     */
+    static bool replaySegment(RedBlackTree& tree, const std::string& path, std::size_t& records);
+
+private:
+    void record(JournalOp op, int key);
+    void encode(JournalOp op, int key);
+    bool openSegment(std::uint64_t number);
+    void startCompaction(std::vector<int> keys, std::uint64_t lastCovered);
+    void flusherLoop();
+    std::string segmentPath(std::uint64_t number) const;
+    std::vector<std::uint64_t> listSegments() const;
+
+    JournalOptions options;
+    std::string basePath;
+    std::uint64_t segmentNumber = 0;
+
+    std::mutex lock;
+    std::mutex writeLock; //held while the flusher writes to file (and while compact() swaps it for a new segment)
+    std::condition_variable flushWanted; //wakes the flusher (buffer full, sync() or closing)
+    std::condition_variable flushed; //wakes sync() callers
+    std::vector<unsigned char> pending; //records not written yet
+    std::uint64_t recorded = 0; //records appended since open()
+    std::uint64_t durable = 0; //records written and fsynced
+    std::uint64_t syncRequested = 0; //sync() callers want everything up to this flushed now
+    bool stopping = false;
+    bool failed = false;
+    std::FILE* file = nullptr;
+    std::thread flusher;
+
+    std::thread compactor;
+    SnapshotStatus compactionStatus = SnapshotStatus::Ok;
+};
+
+/*
+ * What the program calls around a journal, so a failed write is shown to the user instead of dropping updates quietly.
+ * Each does nothing (and returns true) if the journal isn't open.
+ */
+
+/**
+ * @brief sync(), printing to out if a write failed
+ * @return false if updates were lost
+ */
+bool syncJournal(TreeJournal& journal, std::ostream& out);
+
+/**
+ * @brief compact(), printing to out if the previous compaction, a write or the new segment failed
+ * @return false if any of them failed
+ */
+bool compactJournal(TreeJournal& journal, const RedBlackTree& tree, std::ostream& out);
+
+/**
+ * @brief Syncs, waits for a running compaction and closes the journal, printing to out if anything failed
+ * @return false if any of it failed
+ */
+bool closeJournal(TreeJournal& journal, std::ostream& out);
+
+#endif //TREEJOURNAL_H
@@ -0,0 +1,177 @@
+#include "TreeSnapshot.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "FastIntReader.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(SnapshotHeader) == 40, "the snapshot header is part of the file format");
+
+namespace {
+    constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+    constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    std::uint64_t mixRound(const std::uint64_t lane, const std::uint64_t word) {
+        return std::rotl(lane + word * prime2, 31) * prime1;
+    }
+
+    std::uint64_t readWord(const unsigned char* bytes) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+}
+
+//Same structure as xxHash64: four lanes over 32-byte stripes, then the tail, then an avalanche
+std::uint64_t snapshotChecksum(const void* data, const std::size_t length) {
+    const auto* pos = static_cast<const unsigned char*>(data);
+    const unsigned char* end = pos + length;
+    std::uint64_t hash;
+
+    if (length >= 32) {
+        std::uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+        for (; end - pos >= 32; pos += 32) {
+            for (int lane = 0; lane < 4; lane++) {
+                lanes[lane] = mixRound(lanes[lane], readWord(pos + lane * 8));
+            }
+        }
+        hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+        for (const std::uint64_t lane : lanes) {
+            hash = (hash ^ mixRound(0, lane)) * prime1 + prime4;
+        }
+    } else {
+        hash = prime5;
+    }
+    hash += length;
+
+    for (; end - pos >= 8; pos += 8) {
+        hash = std::rotl(hash ^ mixRound(0, readWord(pos)), 27) * prime1 + prime4;
+    }
+    for (; pos < end; pos++) {
+        hash = std::rotl(hash ^ (*pos * prime5), 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+const char* snapshotStatusMessage(const SnapshotStatus status) {
+    switch (status) {
+    case SnapshotStatus::Ok:
+        return "ok";
+    case SnapshotStatus::CannotOpen:
+        return "the file couldn't be opened";
+    case SnapshotStatus::WriteFailed:
+        return "writing the file failed";
+    case SnapshotStatus::NotASnapshot:
+        return "the file isn't a snapshot (or was saved on a machine with a different byte order or int size)";
+    case SnapshotStatus::UnsupportedVersion:
+        return "the snapshot's version isn't one this program reads (saved by a newer version?)";
+    case SnapshotStatus::Truncated:
+        return "the file is the wrong size for its header (truncated?)";
+    case SnapshotStatus::ChecksumMismatch:
+        return "the checksum doesn't match (the file is corrupted)";
+    case SnapshotStatus::Corrupt:
+        return "the keys aren't in ascending order without duplicates (the file is corrupted)";
+    }
+    return "unknown error";
+}
+
+SnapshotStatus saveSnapshot(const RedBlackTree& tree, const std::string& path) {
+    const std::vector<int> keys(tree.begin(), tree.end());
+    return saveSnapshot(keys.data(), keys.size(), path);
+}
+
+SnapshotStatus saveSnapshot(const int* keys, const std::size_t count, const std::string& path) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SnapshotHeader::expectedMagic, sizeof(header.magic));
+    header.version = SnapshotHeader::currentVersion;
+    header.byteOrder = SnapshotHeader::byteOrderMark;
+    header.keyBytes = sizeof(int);
+    header.count = count;
+    header.checksum = snapshotChecksum(keys, count * sizeof(int));
+
+    //write everything to a temporary file first, so the old snapshot survives a failed save
+    const std::string tempPath = path + ".tmp";
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        return SnapshotStatus::CannotOpen;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (written && count > 0) {
+        written = std::fwrite(keys, sizeof(int), count, file) == count;
+    }
+    written = std::fflush(file) == 0 && written;
+    //on the disk before the rename, so a crash can't leave an empty file under the old name
+#ifdef _WIN32
+    written = _commit(_fileno(file)) == 0 && written;
+#else
+    written = fsync(fileno(file)) == 0 && written;
+#endif
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(tempPath.c_str());
+        return SnapshotStatus::WriteFailed;
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str()); //rename doesn't replace an existing file on Windows
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return SnapshotStatus::CannotOpen;
+    }
+    return SnapshotStatus::Ok;
+}
+
+SnapshotStatus loadSnapshot(RedBlackTree& tree, const std::string& path) {
+    InputBuffer input;
+    if (!input.open(path)) {
+        return SnapshotStatus::CannotOpen;
+    }
+
+    SnapshotHeader header;
+    if (input.size() < sizeof(header)) {
+        return SnapshotStatus::NotASnapshot;
+    }
+    std::memcpy(&header, input.begin(), sizeof(header));
+    if (std::memcmp(header.magic, SnapshotHeader::expectedMagic, sizeof(header.magic)) != 0 ||
+        header.byteOrder != SnapshotHeader::byteOrderMark || header.keyBytes != sizeof(int)) {
+        return SnapshotStatus::NotASnapshot;
+    }
+    if (header.version == 0 || header.version > SnapshotHeader::currentVersion) {
+        return SnapshotStatus::UnsupportedVersion;
+    }
+    const std::size_t keyBytes = input.size() - sizeof(header);
+    if (header.count != keyBytes / sizeof(int) || keyBytes % sizeof(int) != 0) {
+        return SnapshotStatus::Truncated;
+    }
+    const char* keyData = input.begin() + sizeof(header);
+    if (snapshotChecksum(keyData, keyBytes) != header.checksum) {
+        return SnapshotStatus::ChecksumMismatch;
+    }
+
+    //the header is a multiple of 8 bytes and the mapping (or buffer) is aligned, so the keys can be read in place
+    const int* keys = reinterpret_cast<const int*>(keyData);
+    //assignSorted trusts its input, so a file that wasn't written by saveSnapshot can't be allowed to break the tree
+    if (std::adjacent_find(keys, keys + header.count, std::greater_equal<>{}) != keys + header.count) {
+        return SnapshotStatus::Corrupt;
+    }
+    tree.assignSorted(keys, keys + header.count);
+    return SnapshotStatus::Ok;
+}
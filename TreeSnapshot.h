@@ -0,0 +1,80 @@
+#ifndef TREESNAPSHOT_H
+#define TREESNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "RedBlackTree.h"
+
+/*
+ * Binary snapshot of an int tree, for restarting without parsing text or inserting keys one by one.
+ * Layout (native byte order, which the header records so a file from another machine is refused instead of misread):
+ *  -SnapshotHeader (40 bytes)
+ *  -count keys in ascending order, no padding
+ * Colors aren't stored: assignSorted derives them from the position of each key, so loading is one linear pass over
+ * the mapped file with no comparisons and no rebalancing.
+ */
+struct SnapshotHeader {
+    static constexpr char expectedMagic[8] = {'R', 'B', 'T', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr std::uint32_t currentVersion = 1;
+    static constexpr std::uint32_t byteOrderMark = 0x01020304;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder; //byteOrderMark as written by the saving machine
+    std::uint32_t keyBytes; //sizeof(int) on the saving machine
+    std::uint32_t reserved; //0 (keeps count 8-byte aligned)
+    std::uint64_t count; //number of keys
+    std::uint64_t checksum; //snapshotChecksum of the key bytes
+};
+
+enum class SnapshotStatus {
+    Ok,
+    CannotOpen, //the file couldn't be opened, created or renamed into place
+    WriteFailed, //ran out of space or the write failed part way (the old file, if any, is left alone)
+    NotASnapshot, //wrong magic, byte order or key size
+    UnsupportedVersion, //0, or newer than currentVersion
+    Truncated, //the file is shorter (or longer) than the header says
+    ChecksumMismatch,
+    Corrupt //the checksum matches but the keys aren't strictly ascending (written by something other than saveSnapshot)
+};
+
+/**
+ * @brief Describes a status for printing
+ */
+const char* snapshotStatusMessage(SnapshotStatus status);
+
+/**
+ * @brief 64-bit checksum of a byte range (four independent multiply/rotate lanes, so it keeps up with memory bandwidth)
+ */
+std::uint64_t snapshotChecksum(const void* data, std::size_t length);
+
+/**
+ * @brief Writes the tree to a snapshot file. The file is written next to path and renamed over it at the end, so a
+ * failed save never leaves a half written snapshot behind
+ * @param tree The tree to save
+ * @param path Where to save it
+ * @return Ok, CannotOpen or WriteFailed
+ */
+SnapshotStatus saveSnapshot(const RedBlackTree& tree, const std::string& path);
+
+/**
+ * @brief Writes keys that were copied out of a tree (so a snapshot can be written on another thread while the tree
+ * keeps changing)
+ * @param keys The keys, ascending with no duplicates
+ * @param count How many there are
+ * @param path Where to save them
+ * @return Ok, CannotOpen or WriteFailed
+ */
+SnapshotStatus saveSnapshot(const int* keys, std::size_t count, const std::string& path);
+
+/**
+ * @brief Replaces the tree's contents with a snapshot. The file is memory mapped, checked (header and checksum) and
+ * then built in one pass (the tree is left alone if any check fails)
+ * @param tree The tree to load into
+ * @param path The snapshot file
+ * @return Ok, or why the file was refused
+ */
+SnapshotStatus loadSnapshot(RedBlackTree& tree, const std::string& path);
+
+#endif //TREESNAPSHOT_H
@@ -0,0 +1,166 @@
+#ifndef TREESTATS_H
+#define TREESTATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+//Build with RBT_STATS=1 (cmake -DRBT_STATS=ON) to count what every tree does. Without it the counting compiles away.
+#ifndef RBT_STATS
+#define RBT_STATS 0
+#endif
+
+//Runs a counting statement only in stats builds, e.g. RBT_STAT(statistics.rotations++);
+#if RBT_STATS
+#define RBT_STAT(statement) statement
+#else
+#define RBT_STAT(statement)
+#endif
+
+
+//A count that const lookups bump, so readers sharing a tree (under a shared lock) can all add to it without racing.
+//Adds are relaxed atomics: the total is exact, there's just no ordering with anything else. Copies take a snapshot
+class StatCounter {
+public:
+    StatCounter() = default;
+    StatCounter(const StatCounter& other) : value(other) {
+    }
+
+    StatCounter& operator=(const StatCounter& other) {
+        value.store(other, std::memory_order_relaxed);
+        return *this;
+    }
+
+    void operator++(int) { value.fetch_add(1, std::memory_order_relaxed); }
+    void operator+=(const std::uint64_t amount) { value.fetch_add(amount, std::memory_order_relaxed); }
+    operator std::uint64_t() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value{0};
+};
+
+
+//Operation latencies in power of two buckets (bucket i holds times under 2^i ns, and at least 2^(i-1) ns)
+struct LatencyHistogram {
+    static constexpr std::size_t bucketCount = 40; //the last bucket takes everything over about 4 minutes
+
+    //StatCounters, since finds are timed from const lookups
+    std::array<StatCounter, bucketCount> buckets{};
+    StatCounter count;
+    StatCounter totalNs;
+
+    void record(const std::uint64_t ns) {
+        buckets[std::min<std::size_t>(std::bit_width(ns), bucketCount - 1)]++;
+        count++;
+        totalNs += ns;
+    }
+
+    /**
+     * @brief Estimates a percentile (rounded up to the top of its bucket, so it's at most 2x too high)
+     * @param fraction 0.5 for the median, 0.99 for p99...
+     * @return Nanoseconds, 0 if nothing was recorded
+     */
+    std::uint64_t percentile(const double fraction) const {
+        const auto target = static_cast<std::uint64_t>(fraction * static_cast<double>(count));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucketCount; i++) {
+            seen += buckets[i];
+            if (seen > target) {
+                return std::uint64_t(1) << i;
+            }
+        }
+        return 0;
+    }
+
+    LatencyHistogram& operator+=(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < bucketCount; i++) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        totalNs += other.totalNs;
+        return *this;
+    }
+};
+
+
+//What a tree has done since it was created (or since its stats were reset)
+struct TreeStats {
+    std::uint64_t rotations = 0;
+    std::uint64_t recolors = 0;
+    std::uint64_t insertFixups = 0; //rounds of the insertBalance loop (more than one per insert means case 2 went up the tree)
+    std::uint64_t removeFixups = 0; //rounds of the removeBalance loop
+    StatCounter comparisons; //calls to the tree's comparator (lookups count too, so this one is atomic)
+    std::uint64_t allocations = 0; //nodes created
+    std::uint64_t frees = 0; //nodes destroyed
+
+    bool timing = false; //latencies are only recorded while this is on (reading the clock costs more than the counters)
+    LatencyHistogram insertLatency;
+    LatencyHistogram removeLatency;
+    LatencyHistogram findLatency;
+
+    TreeStats& operator+=(const TreeStats& other) {
+        rotations += other.rotations;
+        recolors += other.recolors;
+        insertFixups += other.insertFixups;
+        removeFixups += other.removeFixups;
+        comparisons += other.comparisons;
+        allocations += other.allocations;
+        frees += other.frees;
+        insertLatency += other.insertLatency;
+        removeLatency += other.removeLatency;
+        findLatency += other.findLatency;
+        return *this;
+    }
+
+    void print(std::ostream& out) const {
+        out << "rotations:     " << rotations << "\n"
+            << "recolors:      " << recolors << "\n"
+            << "insert fixups: " << insertFixups << "\n"
+            << "remove fixups: " << removeFixups << "\n"
+            << "comparisons:   " << comparisons << "\n"
+            << "allocations:   " << allocations << "\n"
+            << "frees:         " << frees << "\n";
+        const std::pair<const char*, const LatencyHistogram*> histograms[] = {
+            {"insert", &insertLatency}, {"remove", &removeLatency}, {"find", &findLatency}};
+        for (const auto& [name, histogram] : histograms) {
+            if (histogram->count == 0) {
+                continue;
+            }
+            out << name << " latency (ns): " << histogram->count << " ops, mean " << histogram->totalNs / histogram->count
+                << ", p50 < " << histogram->percentile(0.5) << ", p99 < " << histogram->percentile(0.99) << ", p99.9 < "
+                << histogram->percentile(0.999) << "\n";
+        }
+    }
+};
+
+
+//Records how long the enclosing scope took into a histogram (if timing is on)
+class StatTimer {
+public:
+    StatTimer(LatencyHistogram& histogram, const bool timing) : histogram(timing ? &histogram : nullptr) {
+        if (timing) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+    ~StatTimer() {
+        if (histogram != nullptr) {
+            histogram->record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+        }
+    }
+
+private:
+    LatencyHistogram* histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif //TREESTATS_H
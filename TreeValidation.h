@@ -0,0 +1,67 @@
+#ifndef TREEVALIDATION_H
+#define TREEVALIDATION_H
+
+#include <cstddef>
+
+//Build with RBT_CHECK_PATHS=1 (cmake -DRBT_CHECK_PATHS=ON) to check the path every insert and remove touched
+//(O(log^2 n) per update, so it's for debugging). A broken tree prints what's wrong and aborts at the update that broke it.
+#ifndef RBT_CHECK_PATHS
+#define RBT_CHECK_PATHS 0
+#endif
+
+//The first thing validate() found wrong with a tree
+enum class TreeViolation {
+    None,
+    RootNotBlack,
+    BrokenParentLink, //a child doesn't point back at its parent (or the root has a parent)
+    RedRed, //a red node with a red parent
+    BlackHeight, //two paths to a null child pass through a different number of black nodes
+    OutOfOrder, //a key isn't between the keys of the ancestors it's under
+    WrongSubtreeSize, //the augmented subtree size doesn't match the nodes under it
+    WrongMaxEnd, //an interval tree's cached largest end point doesn't match the intervals under it
+    WrongCount, //size() doesn't match the nodes in the tree
+    WrongEnds //the cached first/last node isn't the smallest/largest
+};
+
+/**
+ * @brief Describes a violation for printing
+ */
+inline const char* treeViolationMessage(const TreeViolation violation) {
+    switch (violation) {
+    case TreeViolation::None:
+        return "none";
+    case TreeViolation::RootNotBlack:
+        return "the root is red";
+    case TreeViolation::BrokenParentLink:
+        return "a child doesn't link back to its parent";
+    case TreeViolation::RedRed:
+        return "a red node has a red parent";
+    case TreeViolation::BlackHeight:
+        return "paths have different black heights";
+    case TreeViolation::OutOfOrder:
+        return "a key is out of order";
+    case TreeViolation::WrongSubtreeSize:
+        return "a subtree size is wrong";
+    case TreeViolation::WrongMaxEnd:
+        return "a cached largest end point is wrong";
+    case TreeViolation::WrongCount:
+        return "the node count is wrong";
+    case TreeViolation::WrongEnds:
+        return "the cached first or last node is wrong";
+    }
+    return "unknown violation";
+}
+
+//What a validation pass found. Counts cover the nodes visited, which is every node unless it stopped at a violation
+template <typename Node>
+struct ValidationReport {
+    TreeViolation violation = TreeViolation::None;
+    const Node* node = nullptr; //where the violation was found (nullptr for violations of the whole tree)
+    std::size_t nodeCount = 0;
+    std::size_t maxDepth = 0; //nodes on the longest path (the root is depth 1)
+    int blackHeight = 0; //black nodes on every path from the root to a null child (0 if they differ)
+
+    bool valid() const { return violation == TreeViolation::None; }
+};
+
+#endif //TREEVALIDATION_H
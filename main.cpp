@@ -1,12 +1,23 @@
-#include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <iostream>
 #include <sstream>
 #include <cstring>
 #include <limits>
+#include <vector>
+#include "Benchmark.h"
+#include "FastIntReader.h"
+#include "ParallelLoad.h"
 #include "RedBlackTree.h"
 #include "TestRedBlackTree.h"
+#include "TreeJournal.h"
+#include "TreeSnapshot.h"
 
 using namespace std;
+
+//Write ahead log for the tree, off until the JOURNAL command opens it. Every insert and remove goes through it then
+static TreeJournal journal;
+
 /*!
   @brief Handles user input
   @param rbt       the red black tree
@@ -17,10 +28,18 @@ bool userSelection(RedBlackTree* rbt);
 /*!
   @brief Reads in numbers (separated by spaces) from a file and inserts them into the tree
   @param rbt       the red black tree object
-  @note can take in a file path or the name of a file in the local directory e.g. "C:\Users\476275\Downloads\numbers.txt", numbers.txt (if file is in the local program directory).
+  @note can take in a file path or the name of a file in the local directory e.g. "C:\Users\476275\Downloads\numbers.txt", numbers.txt (if file is in the local program directory), or - to read from stdin.
  */
 void fromFile(RedBlackTree* rbt);
 
+/*!
+  @brief Reads in numbers from a (large) file using every core: parses chunks in parallel, sorts them in parallel and builds the tree in one pass
+  @param rbt       the red black tree object
+  @returns         false if the file couldn't be read (the tree is left alone)
+  @note prints how long each stage took
+ */
+bool fromFileParallel(RedBlackTree* rbt);
+
 /*!
   @brief Reads in numbers (separated by spaces) from the console and inserts them into the tree
   @param rbt       the red black tree
@@ -28,8 +47,21 @@ void fromFile(RedBlackTree* rbt);
 
 void fromConsole(RedBlackTree* rbt);
 
+/*!
+  @brief Asks for a path and recovers the tree from the snapshot and journal saved there, then journals every update after that
+  @param rbt       the red black tree (replaced with what was recovered)
+ */
+void openJournal(RedBlackTree* rbt);
+
+/*!
+  @brief Asks for a format (TEXT, DOT or JSON), a file (or - for the console) and optional depth/key range limits, then exports the tree
+  @param rbt       the red black tree
+ */
+void exportTree(RedBlackTree* rbt);
+
 int main() {
     RedBlackTree* rbt = new RedBlackTree();
+    rbt->setLatencyTiming(true); //only does anything in RBT_STATS builds, the clock reads don't matter at typing speed
 
     //rbt->insert(rbt->root, nullptr, 4);
     //rbt->insert(rbt->root, nullptr, 5);
@@ -39,6 +71,7 @@ int main() {
 
     while (!userSelection(rbt)) {
     }
+    closeJournal(journal, cout); //writes out the last commit window (and says so if it couldn't)
     delete rbt;
     return 0;
 }
@@ -46,10 +79,14 @@ int main() {
 bool userSelection(RedBlackTree* rbt) {
     char userInput[12];
     cout <<
-        "Type CONSOLE to enter a series of numbers in the console. Or type FILE to enter a file name. Type PRINT to print out the tree. Type 'remove' to remove a number from the tree. Type SEARCH to search for a number in the tree. Type TEST to test the tree's functions"
+        "Type CONSOLE to enter a series of numbers in the console. Or type FILE to enter a file name (PFILE to load a big file on every core). Type PRINT to print out the tree (EXPORT to write it as text, DOT or JSON). Type 'remove' to remove a number from the tree. Type SEARCH to search for a number in the tree. Type TEST to test the tree's functions. Type BENCH to run the benchmarks. Type STATS to see the tree's operation counters. Type SAVE or LOAD to save the tree to (or load it from) a binary snapshot. Type JOURNAL to keep the tree on disk (every change is logged and replayed on the next start)"
         << endl;
     cin.getline(userInput, 12);
 
+    if (cin.eof()) {
+        return true; //input was closed (e.g. piped in), nothing more will come
+    }
+
     //in case more than 12 characters are entered (so it won't break the program)
     if (cin.fail()) {
         cin.clear();
@@ -59,8 +96,14 @@ bool userSelection(RedBlackTree* rbt) {
 
     if (strcasecmp(userInput, "FILE") == 0) {
         fromFile(rbt);
+        syncJournal(journal, cout);
+    } else if (strcasecmp(userInput, "PFILE") == 0) {
+        if (fromFileParallel(rbt)) {
+            compactJournal(journal, *rbt, cout); //a bulk load is saved as a snapshot instead of one record per number
+        }
     } else if (strcasecmp(userInput, "CONSOLE") == 0) {
         fromConsole(rbt);
+        syncJournal(journal, cout);
     } else if (strcasecmp(userInput, "PRINT") == 0) {
         if (rbt->root == nullptr) cout << "Nothing in the tree" << endl;
         rbt->print(rbt->root);
@@ -69,11 +112,10 @@ bool userSelection(RedBlackTree* rbt) {
         cout << "What number do you want to remove from the tree?" << endl;
         cin >> num;
 
-        //get the node that matches user input
-        Node* n = RedBlackTree::getNode(rbt->root, num);
-        if (n != nullptr) {
-            rbt->remove(n);
-            //rbt->checkTree();
+        //find and remove the node in one pass
+        if (rbt->erase(num)) {
+            journal.recordRemove(num);
+            syncJournal(journal, cout);
         } else {
             cout << "Invalid number" << endl;
         }
@@ -82,7 +124,7 @@ bool userSelection(RedBlackTree* rbt) {
         int num;
         cout << "What number do you want to search for in the tree?" << endl;
         cin >> num;
-        if (RedBlackTree::getNode(rbt->root, num) != nullptr) {
+        if (rbt->getNode(rbt->root, num) != nullptr) {
             cout << "It is in the tree" << endl;
         } else {
             cout << "This number isn't in the tree" << endl;
@@ -92,6 +134,48 @@ bool userSelection(RedBlackTree* rbt) {
         // Run comprehensive tests
         cout << "Running comprehensive Red-Black Tree tests..." << endl;
         testRedBlackTree();
+    } else if (strcasecmp(userInput, "BENCH") == 0) {
+        size_t keyCount;
+        cout << "How many keys should each benchmark use?" << endl;
+        cin >> keyCount;
+        if (cin.fail()) {
+            cin.clear();
+            cout << "Invalid number" << endl;
+        } else {
+            runBenchmarks(keyCount);
+        }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+    else if (strcasecmp(userInput, "SAVE") == 0 || strcasecmp(userInput, "LOAD") == 0) {
+        const bool saving = strcasecmp(userInput, "SAVE") == 0;
+        string filePath;
+        cout << "Enter the path of the snapshot file" << endl;
+        getline(cin, filePath);
+        if (filePath.size() >= 2 && filePath.front() == '"' && filePath.back() == '"') {
+            filePath = filePath.substr(1, filePath.size() - 2);
+        }
+        const SnapshotStatus status = saving ? saveSnapshot(*rbt, filePath) : loadSnapshot(*rbt, filePath);
+        if (status == SnapshotStatus::Ok) {
+            cout << (saving ? "Saved " : "Loaded ") << rbt->size() << " numbers" << endl;
+            if (!saving) {
+                compactJournal(journal, *rbt, cout); //the loaded tree replaces everything journaled before it
+            }
+        } else {
+            cout << "Snapshot " << (saving ? "save" : "load") << " failed: " << snapshotStatusMessage(status) << endl;
+        }
+    }
+    else if (strcasecmp(userInput, "EXPORT") == 0) {
+        exportTree(rbt);
+    }
+    else if (strcasecmp(userInput, "JOURNAL") == 0) {
+        openJournal(rbt);
+    }
+    else if (strcasecmp(userInput, "STATS") == 0) {
+        if (RedBlackTree::statsEnabled) {
+            rbt->stats().print(cout);
+        } else {
+            cout << "Stats are compiled out. Rebuild with -DRBT_STATS=ON (or define RBT_STATS=1) to count them" << endl;
+        }
     }
     else if (strcasecmp(userInput, "QUIT") == 0) {
         return true;
@@ -113,16 +197,24 @@ void fromFile(RedBlackTree* rbt) {
         filePath = filePath.substr(1, filePath.size() - 2); //makes a substring that doesn't include the double quote
     }
 
-    ifstream inputFile(filePath);
+    //maps the file (or reads stdin/pipes in big blocks) and parses it directly, no stream formatting
+    InputBuffer inputFile;
 
-    if (inputFile.is_open()) {
-        int num;
+    if (inputFile.open(filePath)) {
         cout << "Inserting numbers into the tree..." << endl;
         cout << "Adding numbers from file" << endl;
-        while (inputFile >> num) {
-            rbt->insert(rbt->root, nullptr, num);
-            //      rbt->print(rbt->root);
-            //cout << endl;
+        //parse everything first, then apply it as one sorted batch (an empty tree or a big file gets built in one go)
+        ScanResult skipped;
+        vector<int> numbers;
+        scanInts(inputFile.begin(), inputFile.end(), numbers, skipped);
+        journal.recordInserts(numbers);
+        const size_t duplicates = rbt->insert_batch(numbers).skipped;
+        if (duplicates > 0) {
+            cout << duplicates << " number(s) were already in the tree" << endl;
+        }
+        if (skipped.invalid > 0 || skipped.overflow > 0) {
+            cout << skipped.invalid << " token(s) were not numbers and " << skipped.overflow
+                << " number(s) were too big for an int, they were skipped" << endl;
         }
         //rbt->checkTree();
         inputFile.close();
@@ -131,6 +223,34 @@ void fromFile(RedBlackTree* rbt) {
     }
 }
 
+bool fromFileParallel(RedBlackTree* rbt) {
+    string filePath;
+    cout << "Enter the path of the file you want to read from. Or type the filename if it's in the local directory" <<
+        endl;
+    getline(cin, filePath);
+
+    if (filePath.size() >= 2 && filePath.front() == '"' && filePath.back() == '"') {
+        filePath = filePath.substr(1, filePath.size() - 2);
+    }
+
+    ThreadPool pool;
+    LoadTimings timings;
+    cout << "Loading numbers on " << pool.size() << " thread(s)..." << endl;
+    if (!parallelLoadFile(*rbt, filePath, pool, timings)) {
+        cout << "Cannot find file specified" << endl;
+        return false;
+    }
+
+    cout << "Read:  " << timings.readMs << " ms" << endl;
+    cout << "Parse: " << timings.parseMs << " ms (" << timings.parsed << " numbers)" << endl;
+    cout << "Sort:  " << timings.sortMs << " ms (" << timings.duplicates << " duplicates removed)" << endl;
+    cout << "Build: " << timings.buildMs << " ms (" << rbt->size() << " numbers in the tree)" << endl;
+    if (timings.invalid > 0) {
+        cout << timings.invalid << " token(s) were not numbers and were skipped" << endl;
+    }
+    return true;
+}
+
 
 void fromConsole(RedBlackTree* rbt) {
     string input;
@@ -143,8 +263,86 @@ void fromConsole(RedBlackTree* rbt) {
 
     cout << "Inserting numbers..." << endl;
     //Stream a number till while space is encountered. Do this until end of string is hit
+    vector<int> numbers;
     while (iss >> num) {
-        rbt->insert(rbt->root, nullptr, num); //num == rbt->root->data will give 1 if true (will go right)
+        numbers.push_back(num);
+    }
+    journal.recordInserts(numbers);
+    const size_t duplicates = rbt->insert_batch(numbers).skipped;
+    if (duplicates > 0) {
+        cout << duplicates << " number(s) were already in the tree" << endl;
     }
     rbt->checkTree();
 }
+
+void openJournal(RedBlackTree* rbt) {
+    string basePath;
+    cout << "Enter the path to keep the tree at (the snapshot is saved as <path>.snap and the journal as <path>.wal.N)" << endl;
+    getline(cin, basePath);
+    if (basePath.size() >= 2 && basePath.front() == '"' && basePath.back() == '"') {
+        basePath = basePath.substr(1, basePath.size() - 2);
+    }
+
+    JournalRecovery recovery;
+    if (!journal.open(*rbt, basePath, recovery)) {
+        if (recovery.snapshot != SnapshotStatus::Ok && recovery.snapshot != SnapshotStatus::CannotOpen) {
+            cout << "Snapshot load failed: " << snapshotStatusMessage(recovery.snapshot) << endl;
+        } else {
+            cout << "The journal couldn't be created" << endl;
+        }
+        return;
+    }
+    cout << "Recovered " << rbt->size() << " numbers (" << recovery.records << " journaled change(s) in "
+        << recovery.segments << " segment(s) replayed)" << endl;
+    if (recovery.tornSegments > 0) {
+        cout << recovery.tornSegments << " segment(s) ended in a partly written change, it was dropped" << endl;
+    }
+}
+
+void exportTree(RedBlackTree* rbt) {
+    ExportOptions<int> options;
+    string input;
+    cout << "Enter the format (TEXT, DOT or JSON)" << endl;
+    getline(cin, input);
+    if (strcasecmp(input.c_str(), "DOT") == 0) {
+        options.format = ExportFormat::Dot;
+    } else if (strcasecmp(input.c_str(), "JSON") == 0) {
+        options.format = ExportFormat::Json;
+    } else if (strcasecmp(input.c_str(), "TEXT") != 0) {
+        cout << "Invalid format" << endl;
+        return;
+    }
+
+    string filePath;
+    cout << "Enter the path of the file to write (or - for the console)" << endl;
+    getline(cin, filePath);
+    if (filePath.size() >= 2 && filePath.front() == '"' && filePath.back() == '"') {
+        filePath = filePath.substr(1, filePath.size() - 2);
+    }
+
+    cout << "Enter a maximum depth, optionally followed by the smallest and largest key to include (e.g. 10 -500 500), or press enter for the whole tree" << endl;
+    getline(cin, input);
+    istringstream limits(input);
+    size_t maxDepth;
+    if (limits >> maxDepth) {
+        options.maxDepth = maxDepth;
+        int lower, upper;
+        if (limits >> lower >> upper) {
+            options.lower = lower;
+            options.upper = upper;
+        }
+    }
+
+    size_t written;
+    if (filePath == "-") {
+        written = rbt->exportTree(cout, options);
+    } else {
+        ofstream file(filePath, ios::binary);
+        if (!file) {
+            cout << "Cannot create the file" << endl;
+            return;
+        }
+        written = rbt->exportTree(file, options);
+    }
+    cout << "Exported " << written << " node(s)" << endl;
+}